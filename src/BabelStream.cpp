@@ -0,0 +1,519 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "BabelStream.h"
+#include "StreamModels.h"
+
+#ifdef ENABLE_CALIPER
+#include <caliper/cali.h>
+#endif
+
+static_assert(BS_SELECT_COPY == (int)BenchId::Copy && BS_SELECT_MUL == (int)BenchId::Mul &&
+              BS_SELECT_ADD == (int)BenchId::Add && BS_SELECT_TRIAD == (int)BenchId::Triad &&
+              BS_SELECT_NSTREAM == (int)BenchId::Nstream && BS_SELECT_DOT == (int)BenchId::Dot &&
+              BS_SELECT_CLASSIC == (int)BenchId::Classic && BS_SELECT_ALL == (int)BenchId::All,
+              "BS_SELECT_* must match BenchId");
+static_assert(BS_ORDER_CLASSIC == (int)BenchOrder::Classic &&
+              BS_ORDER_ISOLATED == (int)BenchOrder::Isolated,
+              "BS_ORDER_* must match BenchOrder");
+static_assert(BS_MAX_KERNELS == num_benchmarks, "BS_MAX_KERNELS must match num_benchmarks");
+
+namespace babelstream {
+
+Summary summarise(std::vector<double> const& timings)
+{
+  // Get min/max; ignore the first result
+  auto minmax = std::minmax_element(timings.begin()+1, timings.end());
+
+  // Calculate average; ignore the first result
+  double average = std::accumulate(timings.begin()+1, timings.end(), 0.0)
+    / (double)(timings.size() - 1);
+
+  return {*minmax.first, *minmax.second, average};
+}
+
+template <typename T>
+std::vector<std::vector<double>> run_all(Config const& config, Stream<T>& stream, T& sum)
+{
+  // Times for each measured benchmark:
+  std::vector<std::vector<double>> timings(num_rows);
+
+  // Run a particular benchmark; only the leading thread of the model's region keeps results
+  auto run = [&](Benchmark const& b, bool lead)
+  {
+    switch(b.id) {
+    case BenchId::Copy:    return stream.copy();
+    case BenchId::Mul:     return stream.mul();
+    case BenchId::Add:     return stream.add();
+    case BenchId::Triad:   return stream.triad();
+    case BenchId::Dot:     { T s = stream.dot(); if (lead) sum = s; return; }
+    case BenchId::Nstream: return stream.nstream();
+    default:
+      std::cerr << "Unimplemented benchmark: " << b.label << std::endl;
+      abort();
+    }
+  };
+
+  // Enqueue a particular benchmark without waiting for it; Dot returns a value so it always blocks
+  auto submit = [&](Benchmark const& b, bool lead)
+  {
+    switch(b.id) {
+    case BenchId::Copy:    return stream.submit_copy();
+    case BenchId::Mul:     return stream.submit_mul();
+    case BenchId::Add:     return stream.submit_add();
+    case BenchId::Triad:   return stream.submit_triad();
+    case BenchId::Nstream: return stream.submit_nstream();
+    default:               return run(b, lead);
+    }
+  };
+
+  // Run one sample of a benchmark: a single blocking call, or a batch of submissions and a sync
+  auto sample = [&](Benchmark const& b, bool lead)
+  {
+    if (config.batch <= 1) return run(b, lead);
+    for (size_t r = 0; r < config.batch; r++) submit(b, lead);
+    stream.sync();
+  };
+
+  // Time a particular benchmark, per kernel run:
+  auto dt = [&](Benchmark const& b) {
+    return time([&] { sample(b, true); }) / (double)std::max<size_t>(config.batch, 1);
+  };
+
+  auto before_kernel = [&] { if (config.before_kernel) config.before_kernel(); };
+
+  // A fused pass is one sample of its own row; the kernels' rows stay empty
+  const bool fused = runs_fused(config, stream);
+
+  // Reserve timings:
+  for (size_t i = 0; i < num_benchmarks; ++i) {
+    if (fused || !config.runs(bench[i])) continue;
+    timings[i].reserve(config.num_times);
+  }
+  if (fused) timings[fused_row].reserve(config.num_times);
+
+  stream.run_region([&] {
+    bool lead = stream.leader();
+    switch(config.order) {
+    // Classic runs each benchmark once in the order specifies in the "bench" array above,
+    // and then repeats num_times:
+    case BenchOrder::Classic: {
+      for (size_t k = 0; k < config.num_times; k++) {
+        if (fused) {
+          if (!lead) { stream.classic(); continue; }
+          before_kernel();
+          timings[fused_row].push_back(time([&] { sum = stream.classic(); }));
+          continue;
+        }
+        for (size_t i = 0; i < num_benchmarks; ++i) {
+          if (!config.runs(bench[i])) continue;
+          if (!lead) { sample(bench[i], false); continue; }
+          before_kernel();
+#ifdef ENABLE_CALIPER
+          CALI_MARK_BEGIN(bench[i].label);
+#endif
+          timings[i].push_back(dt(bench[i]));
+#ifdef ENABLE_CALIPER
+          CALI_MARK_END(bench[i].label);
+#endif
+        }
+      }
+      break;
+    }
+    // Isolated runs each benchmark num_times, before proceeding to run the next benchmark:
+    case BenchOrder::Isolated: {
+      for (size_t i = 0; i < num_benchmarks; ++i) {
+        if (!config.runs(bench[i])) continue;
+        if (lead) before_kernel();
+        auto t = time([&] { for (size_t k = 0; k < config.num_times; k++) sample(bench[i], lead); });
+        if (lead) timings[i].resize(config.num_times, t / (double)(config.num_times * std::max<size_t>(config.batch, 1)));
+      }
+      break;
+    }
+    default:
+      std::cerr << "Unimplemented order" << std::endl;
+      abort();
+    }
+  });
+
+  // Compiler should use a move
+  return timings;
+}
+
+template <typename T>
+size_t check_solution(Config const& config, T const* a, T const* b, T const* c, T sum) {
+  // Generate correct solution
+  T goldA = startA;
+  T goldB = startB;
+  T goldC = startC;
+  T goldS = T(0.);
+
+  const T scalar = startScalar;
+
+  // Every sample runs each kernel `batch` times back-to-back
+  const size_t repeats = std::max<size_t>(config.batch, 1);
+
+  // Updates output due to running each benchmark:
+  auto run = [&](int b) {
+    switch(bench[b].id) {
+    case BenchId::Copy:    goldC = goldA; break;
+    case BenchId::Mul:     goldB = scalar * goldC; break;
+    case BenchId::Add:     goldC = goldA + goldB; break;
+    case BenchId::Triad:   goldA = goldB + scalar * goldC; break;
+    case BenchId::Nstream: goldA += goldB + scalar * goldC; break;
+    case BenchId::Dot:     goldS = goldA * goldB * T(config.array_size); break; // This calculates the answer exactly
+    default:
+    std::cerr << "Unimplemented Check: " << bench[b].label << std::endl;
+    abort();
+    }
+  };
+
+  switch(config.order) {
+  // Classic runs each benchmark once in the order specifies in the "bench" array above,
+  // and then repeats num_times:
+  case BenchOrder::Classic: {
+    for (size_t k = 0; k < config.num_times; k++) {
+      for (size_t i = 0; i < num_benchmarks; ++i) {
+	      if (!config.runs(bench[i])) continue;
+	      for (size_t r = 0; r < repeats; r++) run(i);
+      }
+    }
+    break;
+  }
+  // Isolated runs each benchmark num_times, before proceeding to run the next benchmark:
+  case BenchOrder::Isolated: {
+    for (size_t i = 0; i < num_benchmarks; ++i) {
+      if (!config.runs(bench[i])) continue;
+      for (size_t k = 0; k < config.num_times * repeats; k++) run(i);
+    }
+    break;
+  }
+  default:
+    std::cerr << "Unimplemented order" << std::endl;
+    abort();
+  }
+
+  // Error relative tolerance check - a higher tolerance is used for reductions.
+  size_t failed = 0;
+  T max_rel = std::numeric_limits<T>::epsilon() * T(100.0);
+  T max_rel_dot = std::numeric_limits<T>::epsilon() * T(10000000.0);
+  auto check = [&](const char* name, T is, T should, T mrel, size_t i = size_t(-1)) {
+    // Relative difference:
+    T diff = std::abs(is - should);
+    T abs_is = std::abs(is);
+    T abs_sh = std::abs(should);
+    T largest = std::max(abs_is, abs_sh);
+    T same = diff <= largest * mrel;
+    if (!same || std::isnan(is)) {
+      ++failed;
+      if (failed > 10 || !config.report_errors) return;
+      std::cerr << "FAILED validation of " << name;
+      if (i != size_t(-1)) std::cerr << "[" << i << "]";
+      std::cerr << ": " << is << " (is) != " << should
+		<< " (should)" << ", diff=" << diff << " > "
+		<< largest * mrel << " (largest=" << largest
+		<< ", max_rel=" << mrel << ")" << std::endl;
+    }
+  };
+
+  // Sum
+  for (size_t i = 0; i < num_benchmarks; ++i) {
+    if (bench[i].id != BenchId::Dot) continue;
+    if (config.runs(bench[i]))
+      check("sum", sum, goldS, max_rel_dot);
+    break;
+  }
+
+  // Calculate the L^infty-norm relative error of the arrays the selection uses; models
+  // do not allocate the others
+  bool use_a = needs_buffer(config.selection, 'a');
+  bool use_b = needs_buffer(config.selection, 'b');
+  bool use_c = needs_buffer(config.selection, 'c');
+  for (size_t i = 0; i < (size_t)config.array_size; ++i) {
+    if (use_a) check("a", a[i], goldA, max_rel, i);
+    if (use_b) check("b", b[i], goldB, max_rel, i);
+    if (use_c) check("c", c[i], goldC, max_rel, i);
+  }
+
+  return failed;
+}
+
+template <typename T>
+Results<T> run(Config const& config, Stream<T>& stream)
+{
+  Results<T> results;
+  results.timings = run_all<T>(config, stream, results.sum);
+
+  // Create & read host vectors:
+  T const* a;
+  T const* b;
+  T const* c;
+  stream.get_arrays(a, b, c);
+
+  if (config.validate)
+    results.validation_failures = check_solution<T>(config, a, b, c, results.sum);
+  return results;
+}
+
+template <typename T>
+TuneResult tune(Config const& config, Stream<T>& stream)
+{
+  TuneResult result;
+  std::vector<TuneParam> space = stream.tune_space();
+  if (space.empty()) return result;
+
+  // Every combination of the parameters' values, the last parameter varying fastest
+  std::vector<std::vector<long>> points{{}};
+  for (auto const& param : space) {
+    std::vector<std::vector<long>> next;
+    for (auto const& p : points)
+      for (long v : param.values) {
+        next.push_back(p);
+        next.back().push_back(v);
+      }
+    points = std::move(next);
+  }
+  result.points = points.size();
+
+  auto apply = [&](std::vector<long> const& point) {
+    for (size_t j = 0; j < space.size(); ++j)
+      stream.set_tune_param(space[j].name, point[j]);
+  };
+
+  // Sum over the selected kernels of the fastest of `reps` runs, after one run to warm up
+  auto measure = [&](std::vector<long> const& point, size_t reps) {
+    apply(point);
+    std::vector<double> best(num_benchmarks, std::numeric_limits<double>::max());
+    stream.run_region([&] {
+      bool lead = stream.leader();
+      for (size_t i = 0; i < num_benchmarks; ++i) {
+        if (!config.runs(bench[i])) continue;
+        for (size_t r = 0; r <= reps; ++r) {
+          double t = time([&] {
+            switch (bench[i].id) {
+            case BenchId::Copy:    return stream.copy();
+            case BenchId::Mul:     return stream.mul();
+            case BenchId::Add:     return stream.add();
+            case BenchId::Triad:   return stream.triad();
+            case BenchId::Nstream: return stream.nstream();
+            default:               { volatile T s = stream.dot(); (void)s; return; }
+            }
+          });
+          if (lead && r > 0) best[i] = std::min(best[i], t);
+        }
+      }
+    });
+    double cost = 0;
+    for (size_t i = 0; i < num_benchmarks; ++i)
+      if (config.runs(bench[i])) cost += best[i];
+    return cost;
+  };
+
+  std::vector<std::pair<double, size_t>> ranked;
+  if (config.tune == TuneMethod::Halving) {
+    // Each round keeps the faster half of the points and doubles their runs
+    std::vector<size_t> alive(points.size());
+    std::iota(alive.begin(), alive.end(), 0);
+    for (size_t reps = 1;; reps *= 2) {
+      ranked.clear();
+      for (size_t p : alive) ranked.emplace_back(measure(points[p], reps), p);
+      std::sort(ranked.begin(), ranked.end());
+      if (ranked.size() == 1) break;
+      alive.clear();
+      for (size_t k = 0; k < (ranked.size() + 1) / 2; ++k) alive.push_back(ranked[k].second);
+    }
+  } else {
+    for (size_t p = 0; p < points.size(); ++p)
+      ranked.emplace_back(measure(points[p], std::max<size_t>(config.tune_trials, 1)), p);
+    std::sort(ranked.begin(), ranked.end());
+  }
+
+  auto const& best = points[ranked.front().second];
+  apply(best);
+  for (size_t j = 0; j < space.size(); ++j) {
+    auto const& values = space[j].values;
+    size_t v = std::find(values.begin(), values.end(), best[j]) - values.begin();
+    result.best.push_back({space[j].name, best[j],
+                           v < space[j].labels.size() ? space[j].labels[v] : std::string()});
+  }
+  result.seconds = ranked.front().first;
+  return result;
+}
+
+template <typename T>
+std::unique_ptr<Stream<T>> make_tuned(Config const& config,
+                                      std::function<std::unique_ptr<Stream<T>>()> const& make,
+                                      TuneResult& tuned)
+{
+  std::unique_ptr<Stream<T>> stream = make();
+  if (config.tune == TuneMethod::None) return stream;
+  // The search runs on the returned instance, so the model reports its configuration once and
+  // the best point stays applied; only the arrays need restoring
+  tuned = tune<T>(config, *stream);
+  if (!tuned.best.empty()) stream->init_arrays(startA, startB, startC);
+  return stream;
+}
+
+template <typename T>
+Results<T> run(Config const& config)
+{
+  TuneResult tuned;
+  std::unique_ptr<Stream<T>> stream = make_tuned<T>(config, [&] {
+    return make_stream<T>(config.selection, config.array_size, config.device_index, startA, startB, startC);
+  }, tuned);
+  Results<T> results = run<T>(config, *stream);
+  results.tuned = tuned;
+  return results;
+}
+
+template std::vector<std::vector<double>> run_all<float>(Config const&, Stream<float>&, float&);
+template std::vector<std::vector<double>> run_all<double>(Config const&, Stream<double>&, double&);
+template size_t check_solution<float>(Config const&, float const*, float const*, float const*, float);
+template size_t check_solution<double>(Config const&, double const*, double const*, double const*, double);
+template TuneResult tune<float>(Config const&, Stream<float>&);
+template TuneResult tune<double>(Config const&, Stream<double>&);
+template std::unique_ptr<Stream<float>> make_tuned<float>(
+  Config const&, std::function<std::unique_ptr<Stream<float>>()> const&, TuneResult&);
+template std::unique_ptr<Stream<double>> make_tuned<double>(
+  Config const&, std::function<std::unique_ptr<Stream<double>>()> const&, TuneResult&);
+template Results<float> run<float>(Config const&, Stream<float>&);
+template Results<double> run<double>(Config const&, Stream<double>&);
+template Results<float> run<float>(Config const&);
+template Results<double> run<double>(Config const&);
+
+} // namespace babelstream
+
+namespace
+{
+  // Copies a string into a fixed-size C buffer, truncating if needed
+  template <size_t N>
+  void copy_string(char (&dst)[N], std::string const& src)
+  {
+    size_t n = std::min(N - 1, src.size());
+    std::memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+  }
+
+  template <typename T>
+  void run_into(babelstream::Config const& config, bs_results* results)
+  {
+    auto r = babelstream::run<T>(config);
+    results->validation_failures = r.validation_failures;
+    for (size_t i = 0; i < babelstream::num_rows; ++i)
+    {
+      if (r.timings[i].empty()) continue;
+      auto& k = results->kernels[results->num_kernels++];
+      auto s = babelstream::summarise(r.timings[i]);
+      copy_string(k.label, babelstream::row_label(i));
+      k.bytes = double(babelstream::row_weight(i) * sizeof(T) * config.array_size);
+      k.min_seconds = s.min;
+      k.max_seconds = s.max;
+      k.avg_seconds = s.avg;
+      k.bytes_per_second = k.bytes / s.min;
+    }
+  }
+}
+
+extern "C" void bs_config_init(bs_config* config)
+{
+  babelstream::Config defaults;
+  std::memset(config, 0, sizeof(*config));
+  config->struct_size = sizeof(bs_config);
+  config->array_size = defaults.array_size;
+  config->num_times = defaults.num_times;
+  config->device_index = defaults.device_index;
+  config->use_float = 0;
+  config->selection = (int32_t)defaults.selection;
+  config->order = (int32_t)defaults.order;
+  config->validate = 1;
+}
+
+extern "C" void bs_results_init(bs_results* results)
+{
+  std::memset(results, 0, sizeof(*results));
+  results->struct_size = sizeof(bs_results);
+}
+
+namespace
+{
+  // bs_run into a full-size bs_results
+  int run_c(bs_config const* config, bs_results* results)
+  {
+    copy_string(results->implementation, IMPLEMENTATION_STRING);
+
+    auto fail = [&](int status, std::string const& reason) {
+      results->status = status;
+      copy_string(results->error, reason);
+      return status;
+    };
+
+    if (!config || config->struct_size < sizeof(config->struct_size))
+      return fail(BS_ERROR_CONFIG, "bs_config was not initialised with bs_config_init");
+    // Fields the caller's bs_config does not have keep their defaults
+    bs_config defaults;
+    bs_config_init(&defaults);
+    std::memcpy(&defaults, config, std::min<size_t>(config->struct_size, sizeof(bs_config)));
+    config = &defaults;
+
+    if (config->array_size <= 0)
+      return fail(BS_ERROR_CONFIG, "array_size must be positive");
+    if (config->num_times < 2)
+      return fail(BS_ERROR_CONFIG, "num_times must be at least 2");
+    if (config->selection < BS_SELECT_COPY || config->selection > BS_SELECT_ALL)
+      return fail(BS_ERROR_CONFIG, "Unknown kernel selection");
+    if (config->order != BS_ORDER_CLASSIC && config->order != BS_ORDER_ISOLATED)
+      return fail(BS_ERROR_CONFIG, "Unknown run order");
+
+    babelstream::Config c;
+    c.array_size = config->array_size;
+    c.num_times = config->num_times;
+    c.device_index = config->device_index;
+    c.selection = (BenchId)config->selection;
+    c.order = (BenchOrder)config->order;
+    c.validate = config->validate != 0;
+    c.report_errors = false;
+
+    try {
+      copy_string(results->device, getDeviceName(c.device_index));
+      if (config->use_float)
+        run_into<float>(c, results);
+      else
+        run_into<double>(c, results);
+    } catch (std::exception const& e) {
+      return fail(BS_ERROR_RUNTIME, e.what());
+    }
+
+    if (results->validation_failures > 0)
+      return fail(BS_ERROR_VALIDATION, std::to_string(results->validation_failures) +
+                                       " array elements failed validation");
+    return results->status = BS_OK;
+  }
+}
+
+extern "C" int bs_run(bs_config const* config, bs_results* results)
+{
+  // Results are built in a full-size struct, and only the part the caller's struct has is copied out
+  if (!results || results->struct_size < offsetof(bs_results, num_kernels)) return BS_ERROR_CONFIG;
+  bs_results full;
+  bs_results_init(&full);
+  int status = run_c(config, &full);
+  full.struct_size = std::min<uint32_t>(results->struct_size, sizeof(bs_results));
+  std::memcpy(results, &full, full.struct_size);
+  return status;
+}
+
+extern "C" char const* bs_implementation(void)
+{
+  return IMPLEMENTATION_STRING;
+}
@@ -0,0 +1,237 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+// libbabelstream: runs the benchmark in-process against the model the library was built with.
+//
+// The C API below is the stable ABI: structs only ever grow at the end and carry the size the
+// caller was compiled with. bs_run() gives config fields past that size their defaults and never
+// writes results past it, so callers built against an older header keep working. The C++ API
+// (further down) exposes the driver internals shared with the command line tool.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BS_API_VERSION 1
+
+// Kernel selection; values match BenchId
+#define BS_SELECT_COPY    0
+#define BS_SELECT_MUL     1
+#define BS_SELECT_ADD     2
+#define BS_SELECT_TRIAD   3
+#define BS_SELECT_NSTREAM 4
+#define BS_SELECT_DOT     5
+#define BS_SELECT_CLASSIC 6
+#define BS_SELECT_ALL     7
+
+// Run order; values match BenchOrder
+#define BS_ORDER_CLASSIC  0
+#define BS_ORDER_ISOLATED 1
+
+// Status codes returned by bs_run
+#define BS_OK               0
+#define BS_ERROR_CONFIG     1
+#define BS_ERROR_RUNTIME    2
+#define BS_ERROR_VALIDATION 3
+
+#define BS_MAX_KERNELS 6
+
+typedef struct bs_config {
+  uint32_t struct_size;   // sizeof(bs_config), set by bs_config_init
+  int64_t array_size;     // elements per array
+  uint64_t num_times;     // runs per kernel, at least 2 (the first run is not counted)
+  int32_t device_index;
+  int32_t use_float;      // non-zero for single precision
+  int32_t selection;      // BS_SELECT_*
+  int32_t order;          // BS_ORDER_*
+  int32_t validate;       // non-zero to check the arrays after the run
+} bs_config;
+
+typedef struct bs_kernel_result {
+  char label[16];
+  double bytes;           // bytes moved by one run of the kernel
+  double min_seconds;
+  double max_seconds;
+  double avg_seconds;
+  double bytes_per_second; // bytes / min_seconds
+} bs_kernel_result;
+
+typedef struct bs_results {
+  uint32_t struct_size;   // sizeof(bs_results), set by bs_results_init; bs_run stores the bytes it wrote
+  int32_t status;         // same as the return value of bs_run
+  uint32_t num_kernels;
+  uint64_t validation_failures;
+  bs_kernel_result kernels[BS_MAX_KERNELS];
+  char implementation[32];
+  char device[128];
+  char error[256];        // reason for a non-BS_OK status
+} bs_results;
+
+// Fills `config` with the command line tool's defaults
+void bs_config_init(bs_config* config);
+
+// Prepares `results` for bs_run
+void bs_results_init(bs_results* results);
+
+// Runs the benchmark described by `config` and fills `results`. Returns a BS_* status code.
+int bs_run(bs_config const* config, bs_results* results);
+
+// Name of the model the library was built with, e.g. "OpenMP"
+char const* bs_implementation(void);
+
+#ifdef __cplusplus
+}
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Stream.h"
+
+namespace babelstream {
+
+// Search over a model's Stream::tune_space()
+enum class TuneMethod {
+  None,
+  Grid,   // time every point `tune_trials` times
+  Halving // successive halving: time every point once, keep the faster half, double the runs
+};
+
+// Everything a run depends on; defaults match the command line tool
+struct Config {
+  intptr_t array_size = 33554432;
+  size_t num_times = 100;
+  int device_index = 0;
+  BenchId selection = BenchId::Classic;
+  BenchOrder order = BenchOrder::Classic;
+  // Kernels submitted back-to-back per timed sample, with one Stream::sync() at the end; each
+  // sample's time is divided by `batch`. 1 times every blocking call on its own.
+  size_t batch = 1;
+  // Tune the model's parameters before the run
+  TuneMethod tune = TuneMethod::None;
+  size_t tune_trials = 3;
+  // Check the arrays after the run
+  bool validate = true;
+  // Print validation failures to std::cerr
+  bool report_errors = true;
+  // Called before every timed region, e.g. to align instances or MPI ranks
+  std::function<void()> before_kernel;
+
+  bool runs(Benchmark const& b) const { return run_benchmark(selection, b); }
+};
+
+// One parameter of the point chosen by tune(), with the value's label if the model names them
+struct TunedParam {
+  std::string name;
+  long value;
+  std::string label;
+
+  // The label, or else the value
+  std::string str() const { return label.empty() ? std::to_string(value) : label; }
+};
+
+// Outcome of tune(): the fastest point, and the summed best time of one run of each selected
+// kernel at that point
+struct TuneResult {
+  std::vector<TunedParam> best;
+  size_t points = 0;
+  double seconds = 0;
+};
+
+template <typename T>
+struct Results {
+  // Timings of each row of run_all(); empty for rows not run
+  std::vector<std::vector<double>> timings;
+  // Result of the Dot kernel, if used
+  T sum{};
+  // Number of array elements (and sum) failing validation
+  size_t validation_failures = 0;
+  // Parameters chosen by the tuner, if config.tune was set
+  TuneResult tuned;
+};
+
+// Whether run_all() times each pass of the Classic kernels as one sample, through
+// Stream::classic(); the passes then fill fused_row instead of the kernels' rows
+template <typename T>
+bool runs_fused(Config const& config, Stream<T> const& stream) {
+  return config.selection == BenchId::Classic && config.order == BenchOrder::Classic
+    && config.batch <= 1 && stream.fused_classic();
+}
+
+// Rows of run_all()'s timings: one per benchmark in `bench` order, then the fused Classic pass
+constexpr size_t num_rows = num_benchmarks + 1;
+constexpr size_t fused_row = num_benchmarks;
+
+inline char const* row_label(size_t row) {
+  return row == fused_row ? "Classic (fused)" : bench[row].label;
+}
+
+// Elements moved per loop iteration, as Benchmark::weight; a fused pass moves those of every
+// Classic kernel
+inline size_t row_weight(size_t row) {
+  if (row != fused_row) return bench[row].weight;
+  size_t weight = 0;
+  for (auto const& b : bench)
+    if (b.classic) weight += b.weight;
+  return weight;
+}
+
+// Min/max/average of a kernel's timings, ignoring the first (warm-up) result
+struct Summary {
+  double min, max, avg;
+};
+Summary summarise(std::vector<double> const& timings);
+
+// Returns duration of executing function f:
+template <typename F>
+double time(F&& f) {
+  using clk_t = std::chrono::high_resolution_clock;
+  using dur_t = std::chrono::duration<double>;
+  auto start = clk_t::now();
+  f();
+  return dur_t(clk_t::now() - start).count();
+}
+
+// Searches `stream`'s tune space with config.tune, timing the selected kernels at each point, and
+// leaves the best point applied. The kernels overwrite the arrays, so `stream` cannot be validated.
+template <typename T>
+TuneResult tune(Config const& config, Stream<T>& stream);
+
+// Returns a Stream from `make`. With config.tune set, it is tuned, then its arrays are set back
+// to startA, startB and startC, so it runs and validates with the best point applied.
+template <typename T>
+std::unique_ptr<Stream<T>> make_tuned(Config const& config,
+                                      std::function<std::unique_ptr<Stream<T>>()> const& make,
+                                      TuneResult& tuned);
+
+// Runs the selected kernels and returns the timings of each of the num_rows rows
+template <typename T>
+std::vector<std::vector<double>> run_all(Config const& config, Stream<T>& stream, T& sum);
+
+// Checks the arrays and sum against the expected values; returns the number of mismatches
+template <typename T>
+size_t check_solution(Config const& config, T const* a, T const* b, T const* c, T sum);
+
+// Runs the selected kernels on `stream`, which must have been created with the config's
+// selection and array size and the start values, and validates the result
+template <typename T>
+Results<T> run(Config const& config, Stream<T>& stream);
+
+// Creates the model's Stream and runs it as above
+template <typename T>
+Results<T> run(Config const& config);
+
+} // namespace babelstream
+
+#endif
@@ -0,0 +1,66 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+// Files the models keep across runs, such as OpenCL program binaries and SYCL autotune results.
+// Each file is named by a hash of everything that must match for its contents to be reused.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace cache_file
+{
+  // FNV-1a, so file names are the same across standard libraries
+  inline std::string hash_hex(std::string const& s)
+  {
+    unsigned long long h = 14695981039346656037ull;
+    for (unsigned char ch : s)
+    {
+      h ^= ch;
+      h *= 1099511628211ull;
+    }
+    std::ostringstream os;
+    os << std::hex << h;
+    return os.str();
+  }
+
+  // The directory named by `dir_var`, else the user's cache directory. Empty when there is none,
+  // or when `enable_var` is 0 or false, which disables the cache.
+  inline std::string directory(const char* enable_var, const char* dir_var)
+  {
+    if (const char* v = std::getenv(enable_var))
+    {
+      const std::string enable(v);
+      if (enable == "0" || enable == "false" || enable == "FALSE")
+        return "";
+    }
+    if (const char* dir = std::getenv(dir_var))
+      return dir;
+    if (const char* dir = std::getenv("XDG_CACHE_HOME"))
+      return dir;
+    if (const char* home = std::getenv("HOME"))
+      return std::string(home) + "/.cache";
+    return "";
+  }
+
+  // Writes to a temporary file, then renames it over `path`, so concurrent runs never read a
+  // partial file. Failures leave `path` as it was.
+  inline void write(std::string const& path, std::string const& contents)
+  {
+    const std::string tmp = path + ".tmp" + std::to_string(
+      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    std::ofstream out(tmp, std::ios::binary);
+    out.write(contents.data(), contents.size());
+    out.close();
+    if (!out || std::rename(tmp.c_str(), path.c_str()) != 0)
+      std::remove(tmp.c_str());
+  }
+}
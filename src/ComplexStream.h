@@ -0,0 +1,50 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include "Stream.h"
+
+using std::intptr_t;
+
+// Complex-valued Triad and Dot kernels, implemented over two data layouts:
+// - AoS: one array of interleaved std::complex<T> per operand (FFT-library friendly)
+// - SoA: separate real and imaginary arrays of T per operand
+//
+// Both layouts move the same number of bytes, so any bandwidth difference is the
+// cost of the layout itself (e.g. shuffles to de-interleave real/imaginary parts).
+//
+// Implementations should spell out the complex multiply by components rather than use
+// std::complex's operator*, which (without -ffast-math) calls into a library routine for
+// C99 Annex G inf/nan handling and would penalise AoS for reasons unrelated to layout.
+
+// Complex scalar used by Triad
+template <class T>
+constexpr std::complex<T> complexScalar() { return std::complex<T>(T(startScalar), T(startScalar)); }
+
+template <class T>
+class ComplexStream
+{
+  public:
+    virtual ~ComplexStream(){}
+
+    // Kernels
+    // These must be blocking calls
+    //   a[i] = b[i] + scalar * c[i]
+    virtual void triad_aos() = 0;
+    virtual void triad_soa() = 0;
+    //   sum += a[i] * b[i]
+    virtual std::complex<T> dot_aos() = 0;
+    virtual std::complex<T> dot_soa() = 0;
+
+    // Set pointers to read from arrays
+    virtual void get_arrays_aos(std::complex<T> const*& a, std::complex<T> const*& b,
+                                std::complex<T> const*& c) = 0;
+    virtual void get_arrays_soa(T const*& a_re, T const*& a_im, T const*& b_re, T const*& b_im,
+                                T const*& c_re, T const*& c_im) = 0;
+};
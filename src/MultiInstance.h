@@ -0,0 +1,301 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+// Multi-instance mode (--instances N): N copies of the benchmark share one node, each pinned to a
+// disjoint set of CPUs and to the NUMA node(s) local to those CPUs, the way one MPI rank per socket
+// or core group would. Instances are separate processes: the driver forks and re-executes itself
+// once per instance so that threading runtimes (OpenMP, TBB, ...) size themselves from the
+// restricted affinity mask at start-up. Timed regions are aligned with a process-shared barrier
+// living in POSIX shared memory, which also carries the timings back to the launching process.
+//
+// Linux only; other platforms report that the mode is unsupported.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define MULTI_INSTANCE_SUPPORTED 1
+#endif
+
+// Environment variables used to hand an instance its identity across exec
+#define INSTANCE_ENV_ID "BABELSTREAM_INSTANCE"
+#define INSTANCE_ENV_SHM "BABELSTREAM_INSTANCE_SHM"
+
+// CPUs and NUMA nodes an instance is bound to
+struct InstancePlacement {
+  std::vector<int> cpus;
+  std::vector<int> nodes;
+};
+
+// Formats a sorted list of ids as ranges, e.g. "0-3,8"
+inline std::string id_list_string(std::vector<int> const& ids)
+{
+  std::ostringstream os;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    size_t j = i;
+    while (j + 1 < ids.size() && ids[j + 1] == ids[j] + 1) ++j;
+    if (i != 0) os << ",";
+    os << ids[i];
+    if (j != i) os << "-" << ids[j];
+    i = j;
+  }
+  return os.str();
+}
+
+#ifdef MULTI_INSTANCE_SUPPORTED
+
+// Parses a sysfs cpulist such as "0-3,8-11"
+inline std::vector<int> parse_id_list(std::string const& s)
+{
+  std::vector<int> ids;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item == "\n") continue;
+    auto dash = item.find('-');
+    int lo = std::atoi(item.substr(0, dash).c_str());
+    int hi = dash == std::string::npos ? lo : std::atoi(item.substr(dash + 1).c_str());
+    for (int i = lo; i <= hi; ++i) ids.push_back(i);
+  }
+  return ids;
+}
+
+// Returns the NUMA node owning each CPU, or an empty list if the topology is unavailable
+inline std::vector<int> cpu_to_node_map()
+{
+  std::vector<int> map;
+  DIR* dir = opendir("/sys/devices/system/node");
+  if (!dir) return map;
+  while (dirent* e = readdir(dir)) {
+    int node;
+    if (std::sscanf(e->d_name, "node%d", &node) != 1) continue;
+    std::string path = std::string("/sys/devices/system/node/") + e->d_name + "/cpulist";
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) continue;
+    char buf[4096] = {};
+    size_t n = std::fread(buf, 1, sizeof(buf) - 1, f);
+    std::fclose(f);
+    for (int cpu : parse_id_list(std::string(buf, n))) {
+      if (cpu >= (int)map.size()) map.resize(cpu + 1, -1);
+      map[cpu] = node;
+    }
+  }
+  closedir(dir);
+  return map;
+}
+
+// Splits the CPUs this process may run on into n contiguous, disjoint groups of (nearly) equal
+// size. Contiguous CPU ids usually share a socket, so groups line up with NUMA nodes whenever n
+// divides the node count evenly.
+inline std::vector<InstancePlacement> plan_instances(size_t n)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    throw std::runtime_error(std::string("sched_getaffinity failed: ") + std::strerror(errno));
+
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+  if (cpus.size() < n)
+    throw std::runtime_error("Cannot place " + std::to_string(n) + " instances on " +
+                             std::to_string(cpus.size()) + " available CPUs");
+
+  auto node_of = cpu_to_node_map();
+  std::vector<InstancePlacement> placements(n);
+  size_t begin = 0;
+  for (size_t i = 0; i < n; ++i) {
+    size_t count = cpus.size() / n + (i < cpus.size() % n ? 1 : 0);
+    auto& p = placements[i];
+    p.cpus.assign(cpus.begin() + begin, cpus.begin() + begin + count);
+    for (int cpu : p.cpus) {
+      if (cpu >= (int)node_of.size() || node_of[cpu] < 0) continue;
+      if (std::find(p.nodes.begin(), p.nodes.end(), node_of[cpu]) == p.nodes.end())
+        p.nodes.push_back(node_of[cpu]);
+    }
+    std::sort(p.nodes.begin(), p.nodes.end());
+    begin += count;
+  }
+  return placements;
+}
+
+// Binds the calling process to the placement's CPUs and memory to its NUMA nodes.
+// Both settings are inherited across fork and exec.
+inline void bind_instance(InstancePlacement const& p)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : p.cpus) CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    std::cerr << "Warning: sched_setaffinity failed: " << std::strerror(errno) << std::endl;
+
+  if (p.nodes.empty()) return;
+  // set_mempolicy(MPOL_BIND) via the raw syscall so we don't need libnuma
+  constexpr int mpol_bind = 2;
+  constexpr size_t mask_words = 16;
+  unsigned long mask[mask_words] = {};
+  const size_t word_bits = 8 * sizeof(unsigned long);
+  for (int node : p.nodes) {
+    if ((size_t)node >= mask_words * word_bits) continue;
+    mask[node / word_bits] |= 1UL << (node % word_bits);
+  }
+  if (syscall(SYS_set_mempolicy, mpol_bind, mask, mask_words * word_bits + 1) != 0)
+    std::cerr << "Warning: set_mempolicy failed: " << std::strerror(errno) << std::endl;
+}
+
+// Shared state between the launching process and its instances: a process-shared barrier
+// followed by a [instance][slot] table of doubles for the timings.
+class InstanceGroup
+{
+  struct Header {
+    pthread_barrier_t barrier;
+    size_t num_instances;
+    size_t slots;
+  };
+
+  std::string name;
+  Header* header = nullptr;
+  size_t bytes = 0;
+  bool owner = false;
+  intptr_t id = -1;
+
+  static size_t region_bytes(size_t num_instances, size_t slots) {
+    return sizeof(Header) + num_instances * slots * sizeof(double);
+  }
+
+  void map(int fd) {
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+      throw std::runtime_error(std::string("mmap failed: ") + std::strerror(errno));
+    header = static_cast<Header*>(p);
+  }
+
+  public:
+    // Launcher: creates the shared region for num_instances instances of `slots` doubles each
+    InstanceGroup(size_t num_instances, size_t slots)
+      : name("/babelstream-" + std::to_string(getpid())),
+        bytes(region_bytes(num_instances, slots)), owner(true)
+    {
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      if (fd < 0)
+        throw std::runtime_error("shm_open(" + name + ") failed: " + std::strerror(errno));
+      if (ftruncate(fd, bytes) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error(std::string("ftruncate failed: ") + std::strerror(errno));
+      }
+      map(fd);
+      header->num_instances = num_instances;
+      header->slots = slots;
+      pthread_barrierattr_t attr;
+      pthread_barrierattr_init(&attr);
+      pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+      pthread_barrier_init(&header->barrier, &attr, num_instances);
+      pthread_barrierattr_destroy(&attr);
+    }
+
+    // Instance: attaches to the region named by the launcher
+    InstanceGroup(std::string const& name, intptr_t id) : name(name), id(id)
+    {
+      int fd = shm_open(name.c_str(), O_RDWR, 0600);
+      if (fd < 0)
+        throw std::runtime_error("shm_open(" + name + ") failed: " + std::strerror(errno));
+      Header h;
+      if (pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+        close(fd);
+        throw std::runtime_error("Failed to read shared instance header");
+      }
+      bytes = region_bytes(h.num_instances, h.slots);
+      map(fd);
+    }
+
+    ~InstanceGroup()
+    {
+      if (owner) pthread_barrier_destroy(&header->barrier);
+      if (header) munmap(header, bytes);
+      if (owner) shm_unlink(name.c_str());
+    }
+
+    InstanceGroup(InstanceGroup const&) = delete;
+    InstanceGroup& operator=(InstanceGroup const&) = delete;
+
+    std::string const& shm_name() const { return name; }
+    size_t size() const { return header->num_instances; }
+    intptr_t instance_id() const { return id; }
+
+    // Waits for all instances to arrive
+    void barrier() { pthread_barrier_wait(&header->barrier); }
+
+    // Timing slots of instance i
+    double* slots(size_t i) {
+      return reinterpret_cast<double*>(reinterpret_cast<char*>(header) + sizeof(Header)) + i * header->slots;
+    }
+
+    // Forks and re-executes argv once per placement with the instance's identity in the
+    // environment and stdout discarded. Returns true if every instance exited successfully;
+    // if any instance fails the remaining ones are terminated so they don't block on the barrier.
+    bool launch(std::vector<InstancePlacement> const& placements, char* argv[])
+    {
+      std::cout.flush();
+      std::cerr.flush();
+      std::vector<pid_t> pids;
+      for (size_t i = 0; i < placements.size(); ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+          for (pid_t p : pids) kill(p, SIGTERM);
+          throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+        }
+        if (pid == 0) {
+          bind_instance(placements[i]);
+          setenv(INSTANCE_ENV_ID, std::to_string(i).c_str(), 1);
+          setenv(INSTANCE_ENV_SHM, name.c_str(), 1);
+          if (!std::freopen("/dev/null", "w", stdout)) _exit(EXIT_FAILURE);
+          execv("/proc/self/exe", argv);
+          std::cerr << "execv failed: " << std::strerror(errno) << std::endl;
+          _exit(EXIT_FAILURE);
+        }
+        pids.push_back(pid);
+      }
+
+      bool ok = true;
+      for (size_t remaining = pids.size(); remaining > 0; --remaining) {
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0) break;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+          if (ok) {
+            auto it = std::find(pids.begin(), pids.end(), pid);
+            std::cerr << "Instance " << (it - pids.begin()) << " failed, terminating the others" << std::endl;
+            for (pid_t p : pids) if (p != pid) kill(p, SIGTERM);
+          }
+          ok = false;
+        }
+      }
+      return ok;
+    }
+};
+
+#endif // MULTI_INSTANCE_SUPPORTED
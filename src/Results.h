@@ -0,0 +1,311 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+// Machine-readable results (--json) and comparison against a stored baseline (--compare).
+//
+// Every result row the driver prints is also recorded as a KernelRecord, including the raw
+// per-run timings, so a later run can test whether a change in bandwidth is larger than the
+// run-to-run noise of either run.
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct KernelRecord {
+  // Identification: a baseline row matches when all of these are equal
+  std::string model;     // implementation string, e.g. "OpenMP"
+  std::string group;     // instance/rank label or "all" for aggregates, empty otherwise
+  std::string function;  // kernel label, e.g. "Triad"
+  std::string order;     // "Classic" or "Isolated"
+  size_t type_size = 0;
+  size_t n_elements = 0;
+  // Measurements
+  double bytes = 0;                 // bytes moved per run
+  std::vector<double> timings;      // seconds per run, including the first (warm-up) run
+  // Model parameters chosen by --tune, if any: the name and the value, or the value's label
+  std::vector<std::pair<std::string, std::string>> tuned;
+
+  std::string key() const {
+    return model + "|" + group + "|" + function + "|" + order + "|" +
+           std::to_string(type_size) + "|" + std::to_string(n_elements);
+  }
+
+  // Per-run bandwidths in bytes/s, excluding the warm-up run
+  std::vector<double> bandwidths() const {
+    std::vector<double> bw;
+    for (size_t k = 1; k < timings.size(); ++k) bw.push_back(bytes / timings[k]);
+    return bw;
+  }
+
+  // Headline bandwidth in bytes/s, from the fastest run as in the result tables
+  double best_bandwidth() const {
+    auto bw = bandwidths();
+    return bw.empty() ? 0.0 : *std::max_element(bw.begin(), bw.end());
+  }
+
+  // Mean of the per-run bandwidths in bytes/s, which --compare tests
+  double mean_bandwidth() const {
+    auto bw = bandwidths();
+    double sum = 0;
+    for (double b : bw) sum += b;
+    return bw.empty() ? 0.0 : sum / bw.size();
+  }
+};
+
+// Minimal JSON value and parser, sufficient for reading back files written by write_json
+struct JsonValue {
+  enum class Kind {Null, Bool, Number, String, Array, Object} kind = Kind::Null;
+  bool boolean = false;
+  double number = 0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::map<std::string, JsonValue> object;
+
+  JsonValue const& operator[](std::string const& key) const {
+    static const JsonValue null;
+    auto it = object.find(key);
+    return it == object.end() ? null : it->second;
+  }
+};
+
+class JsonParser
+{
+  std::string const& text;
+  size_t pos = 0;
+
+  [[noreturn]] void fail(std::string const& what) {
+    throw std::runtime_error("JSON parse error at offset " + std::to_string(pos) + ": " + what);
+  }
+  void skip() { while (pos < text.size() && std::isspace((unsigned char)text[pos])) ++pos; }
+  bool consume(char c) { skip(); if (pos < text.size() && text[pos] == c) { ++pos; return true; } return false; }
+  void expect(char c) { if (!consume(c)) fail(std::string("expected '") + c + "'"); }
+
+  std::string parse_string() {
+    expect('"');
+    std::string s;
+    while (pos < text.size() && text[pos] != '"') {
+      char c = text[pos++];
+      if (c != '\\') { s += c; continue; }
+      if (pos >= text.size()) fail("unterminated escape");
+      switch (char e = text[pos++]) {
+      case 'n': s += '\n'; break;
+      case 't': s += '\t'; break;
+      case 'r': s += '\r'; break;
+      case 'b': s += '\b'; break;
+      case 'f': s += '\f'; break;
+      case 'u': pos += 4; s += '?'; break; // non-ASCII is never written by write_json
+      default:  s += e;
+      }
+    }
+    expect('"');
+    return s;
+  }
+
+  public:
+    explicit JsonParser(std::string const& text) : text(text) {}
+
+    JsonValue parse() {
+      JsonValue v = parse_value();
+      skip();
+      if (pos != text.size()) fail("trailing characters");
+      return v;
+    }
+
+    JsonValue parse_value() {
+      JsonValue v;
+      skip();
+      if (pos >= text.size()) fail("unexpected end of input");
+      char c = text[pos];
+      if (c == '{') {
+        v.kind = JsonValue::Kind::Object;
+        ++pos;
+        if (consume('}')) return v;
+        do {
+          skip();
+          std::string key = parse_string();
+          expect(':');
+          v.object[key] = parse_value();
+        } while (consume(','));
+        expect('}');
+      } else if (c == '[') {
+        v.kind = JsonValue::Kind::Array;
+        ++pos;
+        if (consume(']')) return v;
+        do { v.array.push_back(parse_value()); } while (consume(','));
+        expect(']');
+      } else if (c == '"') {
+        v.kind = JsonValue::Kind::String;
+        v.string = parse_string();
+      } else if (text.compare(pos, 4, "true") == 0) {
+        v.kind = JsonValue::Kind::Bool; v.boolean = true; pos += 4;
+      } else if (text.compare(pos, 5, "false") == 0) {
+        v.kind = JsonValue::Kind::Bool; pos += 5;
+      } else if (text.compare(pos, 4, "null") == 0) {
+        pos += 4;
+      } else {
+        char* end;
+        v.number = std::strtod(text.c_str() + pos, &end);
+        if (end == text.c_str() + pos) fail("unexpected character");
+        v.kind = JsonValue::Kind::Number;
+        pos = end - text.c_str();
+      }
+      return v;
+    }
+};
+
+inline std::string json_escape(std::string const& s)
+{
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    if (c == '\n') { out += "\\n"; continue; }
+    out += c;
+  }
+  return out;
+}
+
+// A number as itself, anything else as a string
+inline std::string json_value(std::string const& s)
+{
+  char* end = nullptr;
+  std::strtol(s.c_str(), &end, 10);
+  if (!s.empty() && *end == '\0') return s;
+  std::string quoted = "\"";
+  quoted += json_escape(s);
+  quoted += '"';
+  return quoted;
+}
+
+inline void write_json(std::ostream& os, std::string const& version, std::vector<KernelRecord> const& records)
+{
+  os << std::setprecision(17);
+  os << "{\n  \"babelstream_version\": \"" << json_escape(version) << "\",\n  \"results\": [";
+  for (size_t r = 0; r < records.size(); ++r) {
+    auto const& k = records[r];
+    os << (r == 0 ? "\n" : ",\n") << "    {"
+       << "\"model\": \"" << json_escape(k.model) << "\", "
+       << "\"group\": \"" << json_escape(k.group) << "\", "
+       << "\"function\": \"" << json_escape(k.function) << "\", "
+       << "\"order\": \"" << k.order << "\", "
+       << "\"sizeof\": " << k.type_size << ", "
+       << "\"n_elements\": " << k.n_elements << ", "
+       << "\"bytes\": " << k.bytes << ", "
+       << "\"bytes_per_sec\": " << k.best_bandwidth() << ", ";
+    if (!k.tuned.empty()) {
+      os << "\"tuned\": {";
+      for (size_t i = 0; i < k.tuned.size(); ++i)
+        os << (i == 0 ? "" : ", ") << "\"" << json_escape(k.tuned[i].first) << "\": " << json_value(k.tuned[i].second);
+      os << "}, ";
+    }
+    os << "\"timings\": [";
+    for (size_t i = 0; i < k.timings.size(); ++i)
+      os << (i == 0 ? "" : ", ") << k.timings[i];
+    os << "]}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+inline std::vector<KernelRecord> read_json(std::string const& path)
+{
+  std::ifstream in(path);
+  if (!in) throw std::runtime_error("Cannot open " + path);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::string text = ss.str();
+  JsonValue root = JsonParser(text).parse();
+
+  auto const& results = root["results"];
+  if (results.kind != JsonValue::Kind::Array)
+    throw std::runtime_error(path + " is not a BabelStream results file");
+  std::vector<KernelRecord> records;
+  for (auto const& r : results.array) {
+    KernelRecord k;
+    k.model = r["model"].string;
+    k.group = r["group"].string;
+    k.function = r["function"].string;
+    k.order = r["order"].string;
+    k.type_size = (size_t)r["sizeof"].number;
+    k.n_elements = (size_t)r["n_elements"].number;
+    k.bytes = r["bytes"].number;
+    for (auto const& t : r["timings"].array) k.timings.push_back(t.number);
+    records.push_back(k);
+  }
+  return records;
+}
+
+// Regularised incomplete beta function I_x(a, b), via its continued fraction (Lentz's method)
+inline double incomplete_beta(double a, double b, double x)
+{
+  if (x <= 0) return 0;
+  if (x >= 1) return 1;
+  // The continued fraction converges quickly for x < (a+1)/(a+b+2); use the symmetry otherwise
+  if (x > (a + 1) / (a + b + 2)) return 1 - incomplete_beta(b, a, 1 - x);
+
+  const double tiny = 1e-300;
+  double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                          a * std::log(x) + b * std::log(1 - x)) / a;
+  double f = 1, c = 1, d = 0;
+  for (int i = 0; i <= 400; ++i) {
+    int m = i / 2;
+    double numerator;
+    if (i == 0) numerator = 1;
+    else if (i % 2 == 0) numerator = (m * (b - m) * x) / ((a + 2 * m - 1) * (a + 2 * m));
+    else numerator = -((a + m) * (a + b + m) * x) / ((a + 2 * m) * (a + 2 * m + 1));
+    d = 1 + numerator * d;
+    if (std::fabs(d) < tiny) d = tiny;
+    d = 1 / d;
+    c = 1 + numerator / c;
+    if (std::fabs(c) < tiny) c = tiny;
+    double cd = c * d;
+    f *= cd;
+    if (std::fabs(1 - cd) < 1e-12) break;
+  }
+  return front * (f - 1);
+}
+
+// Whether the runs of a sample differ at all. Isolated runs share one averaged timing, so there is
+// no per-run variance to test.
+inline bool varies(std::vector<double> const& v)
+{
+  return std::any_of(v.begin(), v.end(), [&](double e) { return e != v.front(); });
+}
+
+// Two-sided p-value of Welch's t-test for a difference in means between two samples.
+// Returns 0 when both samples are free of noise but differ, 1 when they cannot be told apart.
+inline double welch_p_value(std::vector<double> const& x, std::vector<double> const& y)
+{
+  auto stats = [](std::vector<double> const& v, double& mean, double& var) {
+    mean = 0;
+    for (double e : v) mean += e;
+    mean /= v.size();
+    var = 0;
+    for (double e : v) var += (e - mean) * (e - mean);
+    var = v.size() > 1 ? var / (v.size() - 1) : 0;
+  };
+  if (x.empty() || y.empty()) return 1;
+  double mx, vx, my, vy;
+  stats(x, mx, vx);
+  stats(y, my, vy);
+  double sx = vx / x.size(), sy = vy / y.size();
+  if (sx + sy == 0) return mx == my ? 1 : 0;
+  double t = (mx - my) / std::sqrt(sx + sy);
+  double df = (sx + sy) * (sx + sy) /
+              ((x.size() > 1 ? sx * sx / (x.size() - 1) : 0) + (y.size() > 1 ? sy * sy / (y.size() - 1) : 0));
+  return incomplete_beta(df / 2, 0.5, df / (df + t * t));
+}
@@ -9,6 +9,7 @@
 
 #include <cstdint>
 #include <array>
+#include <functional>
 #include <vector>
 #include <string>
 #include "benchmark.h"
@@ -20,6 +21,16 @@
 
 using std::intptr_t;
 
+// A runtime parameter a model lets the driver's tuner (--tune) search, with its candidate values
+struct TuneParam
+{
+  std::string name;
+  std::vector<long> values;
+  // Names of the values, in the same order, for parameters selecting one of several options;
+  // empty for numeric parameters
+  std::vector<std::string> labels = {};
+};
+
 // Array values
 #define startA (0.1)
 #define startB (0.2)
@@ -41,8 +52,43 @@ class Stream
     virtual void nstream() = 0;
     virtual T dot() = 0;
 
-    // Set pointers to read from arrays
+    // Optional non-blocking kernels, used by the driver's --batch mode: each call enqueues the
+    // kernel after all previously submitted ones and may return before it completes; sync()
+    // blocks until everything submitted has finished. The defaults fall back to the blocking
+    // kernels, so batches on other models time the same work with one call per kernel.
+    virtual void submit_copy() { copy(); }
+    virtual void submit_mul() { mul(); }
+    virtual void submit_add() { add(); }
+    virtual void submit_triad() { triad(); }
+    virtual void submit_nstream() { nstream(); }
+    virtual void sync() {}
+
+    // Set pointers to read from arrays. Models only allocate, initialise and read back the arrays
+    // for which needs_buffer() holds for the BenchId they were constructed with; the pointers to
+    // the others may be null.
     virtual void get_arrays(T const*& a, T const*& b, T const*& c) = 0;
+
+    // Sets every element of the arrays the model allocated to the given values
+    virtual void init_arrays(T initA, T initB, T initC) = 0;
+
+    // Runs the driver's timed loop over the kernels. A model may override this to enter one
+    // parallel region spanning all kernels: `loop` may then be executed by several threads at
+    // once, and only the thread for which leader() is true times kernels and records results.
+    virtual void run_region(std::function<void()> const& loop) { loop(); }
+    virtual bool leader() const { return true; }
+
+    // Optional fused Classic pass: runs Copy, Mul, Add, Triad and Dot in that order as one unit,
+    // e.g. without returning to the host between kernels, and returns Dot's result. When
+    // fused_classic() holds, the driver runs a Classic selection in Classic order through
+    // classic(), timing each pass as one sample of a single "Classic (fused)" row.
+    virtual bool fused_classic() const { return false; }
+    virtual T classic() { copy(); mul(); add(); triad(); return dot(); }
+
+    // Parameter space searched by --tune; empty when the model has nothing to tune.
+    // set_tune_param() applies one value of a declared parameter between kernels, without
+    // changing the arrays.
+    virtual std::vector<TuneParam> tune_space() { return {}; }
+    virtual void set_tune_param(std::string const&, long) {}
 };
 
 // Implementation specific device functions
@@ -1,5 +1,8 @@
 #pragma once
 #include <memory>
+#include <tuple>
+
+#include "ComplexStream.h"
 
 #if defined(CUDA)
 #include "CUDAStream.h"
@@ -29,6 +32,10 @@
 #include "OMPStream.h"
 #elif defined(SERIAL)
 #include "SerialStream.h"
+#elif defined(CORO)
+#include "CoroStream.h"
+#elif defined(USE_STDEXEC)
+#include "StdexecStream.h"
 #elif defined(FUTHARK)
 #include "FutharkStream.h"
 #endif
@@ -87,6 +94,14 @@ std::unique_ptr<Stream<T>> make_stream(Args... args) {
   // Use the Serial implementation
   return std::make_unique<SerialStream<T>>(args...);
 
+#elif defined(CORO)
+  // Use the experimental C++20 coroutine task runtime
+  return std::make_unique<CoroStream<T>>(args...);
+
+#elif defined(USE_STDEXEC)
+  // Use the senders/receivers implementation
+  return std::make_unique<StdexecStream<T>>(args...);
+
 #elif defined(FUTHARK)
   // Use the Futhark implementation
   return std::make_unique<FutharkStream<T>>(args...);
@@ -97,3 +112,23 @@ std::unique_ptr<Stream<T>> make_stream(Args... args) {
 
 #endif
 }
+
+// Complex-valued AoS vs SoA kernels are only implemented for the CPU models
+template <typename T, typename...Args>
+std::unique_ptr<ComplexStream<T>> make_complex_stream(Args... args) {
+#if defined(OMP) && !defined(OMP_TARGET_GPU)
+  return std::make_unique<OMPComplexStream<T>>(args...);
+
+#elif defined(TBB)
+  return std::make_unique<TBBComplexStream<T>>(args...);
+
+#elif defined(SERIAL)
+  return std::make_unique<SerialComplexStream<T>>(args...);
+
+#else
+  // Not implemented by this model
+  (void)std::forward_as_tuple(args...);
+  return nullptr;
+
+#endif
+}
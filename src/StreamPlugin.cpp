@@ -0,0 +1,39 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+// Entry point of the babelstream-<model> plugin module, see StreamPlugin.h
+
+#include "StreamPlugin.h"
+#include "StreamModels.h"
+
+#ifndef BABELSTREAM_MODEL
+#error "BABELSTREAM_MODEL must name the model this plugin is built for"
+#endif
+
+namespace
+{
+  template <typename T>
+  Stream<T>* make(BenchId bs, intptr_t array_size, int device_id, T initA, T initB, T initC)
+  {
+    return make_stream<T>(bs, array_size, device_id, initA, initB, initC).release();
+  }
+
+  const StreamPlugin plugin = {
+    STREAM_PLUGIN_ABI_VERSION,
+    BABELSTREAM_MODEL,
+    IMPLEMENTATION_STRING,
+    make<float>,
+    make<double>,
+    listDevices,
+    getDeviceName,
+    getDeviceDriver,
+  };
+}
+
+extern "C" __attribute__((visibility("default"))) StreamPlugin const* babelstream_plugin()
+{
+  return &plugin;
+}
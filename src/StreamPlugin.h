@@ -0,0 +1,156 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+// Model plugins: a model built with -DBUILD_MODEL_PLUGIN=ON is also packaged as a loadable module
+// (babelstream-<model>.so) exporting babelstream_plugin(), which returns a table of factories
+// wrapping the model's make_stream and device queries. The driver loads plugins with --model so
+// several models can run back-to-back in one process.
+//
+// Stream<T> objects cross the module boundary, so plugins must be built with a compiler using the
+// same C++ ABI as the driver; the ABI version guards against mismatched struct layouts.
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Stream.h"
+
+#define STREAM_PLUGIN_ABI_VERSION 5
+#define STREAM_PLUGIN_ENTRY "babelstream_plugin"
+#define STREAM_PLUGIN_PREFIX "babelstream-"
+#define STREAM_PLUGIN_SUFFIX ".so"
+// Colon-separated directories searched for plugins before the executable's own directory
+#define STREAM_PLUGIN_PATH_ENV "BABELSTREAM_PLUGIN_PATH"
+
+struct StreamPlugin {
+  int abi_version;
+  // Model name as passed to CMake's -DMODEL, e.g. "omp"
+  char const* model;
+  // The model's IMPLEMENTATION_STRING, e.g. "OpenMP"
+  char const* implementation;
+  // Factories: same arguments as make_stream, ownership passes to the caller
+  Stream<float>* (*make_float)(BenchId, intptr_t, int, float, float, float);
+  Stream<double>* (*make_double)(BenchId, intptr_t, int, double, double, double);
+  void (*list_devices)();
+  std::string (*device_name)(int);
+  std::string (*device_driver)(int);
+
+  template <typename T>
+  std::unique_ptr<Stream<T>> make_stream(BenchId bs, intptr_t array_size, int device_id,
+                                         T initA, T initB, T initC) const {
+    if constexpr (sizeof(T) == sizeof(float))
+      return std::unique_ptr<Stream<T>>(make_float(bs, array_size, device_id, initA, initB, initC));
+    else
+      return std::unique_ptr<Stream<T>>(make_double(bs, array_size, device_id, initA, initB, initC));
+  }
+};
+
+typedef StreamPlugin const* (*StreamPluginEntry)();
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <dirent.h>
+#include <dlfcn.h>
+#include <unistd.h>
+
+// Directories searched for plugins: $BABELSTREAM_PLUGIN_PATH, then the executable's directory
+inline std::vector<std::string> plugin_search_path()
+{
+  std::vector<std::string> dirs;
+  if (char const* env = std::getenv(STREAM_PLUGIN_PATH_ENV))
+  {
+    std::string paths(env);
+    size_t begin = 0;
+    while (begin <= paths.size())
+    {
+      size_t end = paths.find(':', begin);
+      if (end == std::string::npos) end = paths.size();
+      if (end > begin) dirs.push_back(paths.substr(begin, end - begin));
+      begin = end + 1;
+    }
+  }
+  char exe[4096];
+  ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+  if (n > 0)
+  {
+    std::string path(exe, n);
+    dirs.push_back(path.substr(0, path.find_last_of('/')));
+  }
+  return dirs;
+}
+
+// Loads one plugin from a path; the module stays loaded for the lifetime of the process
+inline StreamPlugin const* load_plugin(std::string const& path)
+{
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle)
+    throw std::runtime_error(std::string("Cannot load plugin: ") + dlerror());
+  auto entry = reinterpret_cast<StreamPluginEntry>(dlsym(handle, STREAM_PLUGIN_ENTRY));
+  if (!entry)
+    throw std::runtime_error(path + " is not a BabelStream plugin");
+  StreamPlugin const* plugin = entry();
+  if (!plugin || plugin->abi_version != STREAM_PLUGIN_ABI_VERSION)
+    throw std::runtime_error(path + " was built for a different plugin ABI version");
+  return plugin;
+}
+
+// Resolves a --model argument: a path (containing '/'), a model name looked up on the search
+// path, or "all" for every plugin found on the search path (first match per model wins).
+inline std::vector<StreamPlugin const*> load_plugins(std::string const& spec)
+{
+  if (spec.find('/') != std::string::npos)
+    return {load_plugin(spec)};
+
+  auto dirs = plugin_search_path();
+  std::vector<StreamPlugin const*> plugins;
+  if (spec != "all")
+  {
+    for (auto const& dir : dirs)
+    {
+      std::string path = dir + "/" STREAM_PLUGIN_PREFIX + spec + STREAM_PLUGIN_SUFFIX;
+      if (access(path.c_str(), R_OK) == 0)
+        return {load_plugin(path)};
+    }
+    throw std::runtime_error("No plugin found for model \"" + spec + "\" (searched $"
+                             STREAM_PLUGIN_PATH_ENV " and the executable's directory)");
+  }
+
+  std::vector<std::string> seen;
+  for (auto const& dir : dirs)
+  {
+    std::vector<std::string> names;
+    if (DIR* d = opendir(dir.c_str()))
+    {
+      while (dirent* e = readdir(d))
+      {
+        std::string name = e->d_name;
+        std::string prefix = STREAM_PLUGIN_PREFIX, suffix = STREAM_PLUGIN_SUFFIX;
+        if (name.size() > prefix.size() + suffix.size() &&
+            name.compare(0, prefix.size(), prefix) == 0 &&
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+          names.push_back(name);
+      }
+      closedir(d);
+    }
+    std::sort(names.begin(), names.end());
+    for (auto const& name : names)
+    {
+      if (std::find(seen.begin(), seen.end(), name) != seen.end()) continue;
+      seen.push_back(name);
+      plugins.push_back(load_plugin(dir + "/" + name));
+    }
+  }
+  if (plugins.empty())
+    throw std::runtime_error("No plugins found (searched $" STREAM_PLUGIN_PATH_ENV
+                             " and the executable's directory)");
+  return plugins;
+}
+#define STREAM_PLUGIN_SUPPORTED 1
+#endif
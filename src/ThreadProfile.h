@@ -0,0 +1,155 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+// Per-thread timing for the CPU models, enabled with BABELSTREAM_THREAD_PROFILE=1.
+//
+// A kernel invocation is bracketed by begin()/end(). In between, each worker calls record() once
+// per chunk of work it completes, with the chunk's start/end time and element count. Records go
+// to the worker's own cache-line sized slot, so the hot loop is untouched and workers never share
+// a line. end() folds the slots into per-kernel statistics:
+// - imbalance: (max - mean) / mean of the per-thread busy time, i.e. how long the slowest thread
+//   kept the others waiting at the implicit barrier, relative to a perfectly balanced run;
+// - which thread (and on which CPU) was the slowest, to spot cores hit by IRQs or noisy neighbours.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+class ThreadProfile
+{
+  public:
+    struct alignas(64) Slot {
+      double start, end, busy;
+      size_t elements;
+      int cpu;
+    };
+
+  private:
+    struct KernelStats {
+      size_t invocations = 0;
+      double imbalance_sum = 0;
+      double imbalance_max = 0;
+      // Per thread: times it was the slowest, and the CPU it last ran on
+      std::vector<size_t> slowest;
+      std::vector<int> cpu;
+      std::vector<size_t> elements;
+    };
+
+    bool enabled_;
+    std::vector<Slot> slots;
+    std::map<std::string, KernelStats> stats;
+    // Kernel names in first-run order, for reporting
+    std::vector<std::string> order;
+
+  public:
+    ThreadProfile() {
+      char const* env = std::getenv("BABELSTREAM_THREAD_PROFILE");
+      enabled_ = env && std::string(env) != "0";
+    }
+
+    bool enabled() const { return enabled_; }
+
+    static double now() {
+      using clk_t = std::chrono::steady_clock;
+      return std::chrono::duration<double>(clk_t::now().time_since_epoch()).count();
+    }
+
+    static int current_cpu() {
+#if defined(__linux__)
+      return sched_getcpu();
+#else
+      return -1;
+#endif
+    }
+
+    // Starts an invocation run by up to `workers` threads
+    void begin(size_t workers) {
+      slots.assign(workers, Slot{0, 0, 0, 0, -1});
+    }
+
+    // Called by worker `w` after finishing a chunk of `n` elements that ran from t0 to t1
+    void record(size_t w, double t0, double t1, size_t n) {
+      Slot& s = slots[w];
+      if (s.elements == 0 || t0 < s.start) s.start = t0;
+      s.end = std::max(s.end, t1);
+      s.busy += t1 - t0;
+      s.elements += n;
+      s.cpu = current_cpu();
+    }
+
+    // Ends the invocation of `kernel`; the first invocation of each kernel is treated as warm-up
+    void end(char const* kernel) {
+      auto it = stats.find(kernel);
+      if (it == stats.end()) {
+        order.push_back(kernel);
+        stats[kernel].slowest.assign(slots.size(), 0);
+        stats[kernel].cpu.assign(slots.size(), -1);
+        stats[kernel].elements.assign(slots.size(), 0);
+        return;
+      }
+      KernelStats& k = it->second;
+      double sum = 0, max = 0;
+      size_t active = 0, slowest = 0;
+      for (size_t w = 0; w < slots.size(); ++w) {
+        if (slots[w].elements == 0) continue;
+        ++active;
+        sum += slots[w].busy;
+        if (slots[w].busy > max) { max = slots[w].busy; slowest = w; }
+        k.cpu[w] = slots[w].cpu;
+        k.elements[w] = slots[w].elements;
+      }
+      if (active == 0) return;
+      double mean = sum / active;
+      double imbalance = mean > 0 ? (max - mean) / mean : 0;
+      k.invocations++;
+      k.imbalance_sum += imbalance;
+      k.imbalance_max = std::max(k.imbalance_max, imbalance);
+      k.slowest[slowest]++;
+    }
+
+    // Prints per-kernel imbalance and the threads most often slowest
+    void report(std::ostream& os, char const* model) const {
+      if (!enabled_ || order.empty()) return;
+      std::streamsize ss = os.precision();
+      os << std::endl << model << " per-thread profile "
+         << "(imbalance = (max - mean) / mean of per-thread busy time)" << std::endl
+         << std::left << std::setw(12) << "Function"
+         << std::left << std::setw(12) << "Mean (%)"
+         << std::left << std::setw(12) << "Max (%)"
+         << "Slowest threads (thread@cpu: count, elements)" << std::endl;
+      for (auto const& name : order) {
+        KernelStats const& k = stats.at(name);
+        if (k.invocations == 0) continue;
+        os << std::left << std::setw(12) << name << std::fixed << std::setprecision(2)
+           << std::left << std::setw(12) << (100.0 * k.imbalance_sum / k.invocations)
+           << std::left << std::setw(12) << (100.0 * k.imbalance_max);
+        std::vector<size_t> threads;
+        for (size_t w = 0; w < k.slowest.size(); ++w)
+          if (k.slowest[w] > 0) threads.push_back(w);
+        std::sort(threads.begin(), threads.end(),
+                  [&](size_t x, size_t y) { return k.slowest[x] > k.slowest[y]; });
+        for (size_t i = 0; i < threads.size() && i < 3; ++i) {
+          size_t w = threads[i];
+          os << (i == 0 ? "" : ", ") << w << "@" << k.cpu[w] << ": " << k.slowest[w]
+             << ", " << k.elements[w];
+        }
+        os << std::endl;
+      }
+      os.precision(ss);
+      os.unsetf(std::ios_base::floatfield);
+    }
+};
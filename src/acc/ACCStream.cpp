@@ -15,16 +15,18 @@ ACCStream<T>::ACCStream(BenchId bs, const intptr_t array_size, const int device_
   acc_device_t device_type = acc_get_device_type();
   acc_set_device_num(device_id, device_type);
 
-  // Set up data region on device
-  this->a = new T[array_size];
-  this->b = new T[array_size];
-  this->c = new T[array_size];
+  // Set up data region on device, only for the arrays the selected benchmarks use
+  this->a = needs_buffer(bs, 'a') ? new T[array_size] : nullptr;
+  this->b = needs_buffer(bs, 'b') ? new T[array_size] : nullptr;
+  this->c = needs_buffer(bs, 'c') ? new T[array_size] : nullptr;
 
   T * restrict a = this->a;
   T * restrict b = this->b;
   T * restrict c = this->c;
+  // Unused arrays are null and appear as empty sections
+  intptr_t na = a ? array_size : 0, nb = b ? array_size : 0, nc = c ? array_size : 0;
 
-  #pragma acc enter data create(a[0:array_size], b[0:array_size], c[0:array_size])
+  #pragma acc enter data create(a[0:na], b[0:nb], c[0:nc])
   {}
 
   init_arrays(initA, initB, initC);
@@ -39,8 +41,9 @@ ACCStream<T>::~ACCStream()
   T * restrict a = this->a;
   T * restrict b = this->b;
   T * restrict c = this->c;
+  intptr_t na = a ? array_size : 0, nb = b ? array_size : 0, nc = c ? array_size : 0;
 
-  #pragma acc exit data delete(a[0:array_size], b[0:array_size], c[0:array_size])
+  #pragma acc exit data delete(a[0:na], b[0:nb], c[0:nc])
   {}
 
   delete[] a;
@@ -55,12 +58,13 @@ void ACCStream<T>::init_arrays(T initA, T initB, T initC)
   T * restrict a = this->a;
   T * restrict b = this->b;
   T * restrict c = this->c;
-  #pragma acc parallel loop present(a[0:array_size], b[0:array_size], c[0:array_size]) wait
+  intptr_t na = a ? array_size : 0, nb = b ? array_size : 0, nc = c ? array_size : 0;
+  #pragma acc parallel loop present(a[0:na], b[0:nb], c[0:nc]) wait
   for (intptr_t i = 0; i < array_size; i++)
   {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
+    if (a) a[i] = initA;
+    if (b) b[i] = initB;
+    if (c) c[i] = initC;
   }
 }
 
@@ -70,7 +74,8 @@ void ACCStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
   T *a = this->a;
   T *b = this->b;
   T *c = this->c;
-  #pragma acc update host(a[0:array_size], b[0:array_size], c[0:array_size])
+  intptr_t na = a ? array_size : 0, nb = b ? array_size : 0, nc = c ? array_size : 0;
+  #pragma acc update host(a[0:na], b[0:nb], c[0:nc])
   {}
 
   h_a = a;
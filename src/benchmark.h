@@ -38,6 +38,11 @@ constexpr std::array<Benchmark, num_benchmarks> bench = {
   Benchmark { .id = BenchId::Nstream, .label = "Nstream", .weight = 4, .classic = false }
 };
 
+// Benchmark run order
+// - Classic: runs each bench once in the order above, and repeats n times.
+// - Isolated: runs each bench n times in isolation
+enum class BenchOrder : int {Classic, Isolated};
+
 // Which buffers are needed by each benchmark
 inline bool needs_buffer(BenchId id, char n) {
   auto in = [n](std::initializer_list<char> values) {
@@ -0,0 +1,477 @@
+
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+// A small work-stealing task runtime on C++20 coroutines:
+// - The arrays are split into cache-line aligned chunks, each handled by one coroutine that lives
+//   as long as the stream. Resuming it runs the current kernel on its chunk, then it suspends.
+// - Every chunk is owned by one worker, which initialises it and so first-touches its pages.
+//   A kernel launch pushes each chunk's coroutine onto its owner's deque.
+// - Workers pop their own deque from the back. When it is empty, they steal from the front of the
+//   deques of workers sharing their last-level cache, never across LLC domains, so stolen chunks
+//   are at worst a cache-to-cache transfer away rather than a remote NUMA node.
+// - The calling thread acts as worker 0; the other workers are pinned threads that spin briefly
+//   and then sleep between kernels.
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "CoroStream.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifndef ALIGNMENT
+#define ALIGNMENT (2*1024*1024) // 2MB
+#endif
+
+#define CACHE_LINE 64
+
+namespace
+{
+  // Coroutine of one chunk; created suspended, it is resumed once per kernel launch
+  struct ChunkTask {
+    struct promise_type {
+      ChunkTask get_return_object() {
+        return {std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+  };
+
+  void cpu_relax()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  size_t env_size(char const* name, size_t fallback)
+  {
+    char const* env = std::getenv(name);
+    if (!env || !*env) return fallback;
+    char* end = nullptr;
+    size_t value = std::strtoull(env, &end, 10);
+    if (value == 0 || *end != '\0')
+      throw std::runtime_error(std::string("Invalid ") + name + ": " + env);
+    return value;
+  }
+
+  // CPUs the process may run on
+  std::vector<int> allowed_cpus()
+  {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t mask;
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &mask)) cpus.push_back(cpu);
+#endif
+    if (cpus.empty())
+      for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+        cpus.push_back(cpu);
+    return cpus;
+  }
+
+  // Identifies the last-level cache of a CPU by the CPUs sharing it, from Linux sysfs; CPUs
+  // whose cache topology is unknown all land in one domain
+  std::string llc_domain(int cpu)
+  {
+    std::string shared;
+    int best_level = 0;
+    for (int index = 0;; ++index) {
+      std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                        "/cache/index" + std::to_string(index) + "/";
+      std::ifstream level_file(dir + "level");
+      if (!level_file) break;
+      int level = 0;
+      std::string list;
+      level_file >> level;
+      std::ifstream(dir + "shared_cpu_list") >> list;
+      if (level > best_level && !list.empty()) {
+        best_level = level;
+        shared = list;
+      }
+    }
+    return shared;
+  }
+
+  void pin_to(int cpu)
+  {
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    sched_setaffinity(0, sizeof(mask), &mask);
+#else
+    (void)cpu;
+#endif
+  }
+}
+
+class CoroScheduler
+{
+  public:
+    // Type-erased kernel body, called as call(ctx, chunk, begin, end)
+    struct Kernel {
+      void* ctx;
+      void (*call)(void*, size_t, size_t, size_t);
+    };
+
+  private:
+    struct alignas(CACHE_LINE) Worker {
+      std::mutex lock;
+      std::deque<std::coroutine_handle<>> queue;
+      // Other workers in the same LLC domain, in the order they are tried when stealing
+      std::vector<size_t> peers;
+      // Owned chunks: [first_chunk, last_chunk)
+      size_t first_chunk = 0, last_chunk = 0;
+      int cpu = -1;
+      size_t steals = 0;
+      std::thread thread;
+    };
+
+    // Suspends a chunk's coroutine, then counts the chunk as done. The count is only published
+    // once the coroutine is suspended, as the next launch may resume it on another thread.
+    struct ChunkDone {
+      std::atomic<size_t>& remaining;
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<>) const noexcept {
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+      }
+      void await_resume() const noexcept {}
+    };
+
+    size_t n, chunk;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<ChunkTask> tasks;
+    size_t num_domains = 0;
+    size_t spin;
+
+    Kernel kernel{};
+    std::atomic<bool> stealing{true};
+    std::atomic<size_t> remaining{0};
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> stop{false};
+    size_t stealable_runs = 0;
+
+#if defined(__linux__)
+    cpu_set_t caller_mask;
+#endif
+
+    ChunkTask chunk_loop(size_t k)
+    {
+      size_t begin = k * chunk, end = std::min(n, begin + chunk);
+      for (;;) {
+        kernel.call(kernel.ctx, k, begin, end);
+        co_await ChunkDone{remaining};
+      }
+    }
+
+    std::coroutine_handle<> pop(Worker& w)
+    {
+      std::lock_guard<std::mutex> guard(w.lock);
+      if (w.queue.empty()) return {};
+      auto h = w.queue.back();
+      w.queue.pop_back();
+      return h;
+    }
+
+    std::coroutine_handle<> steal(Worker& w)
+    {
+      for (size_t p : w.peers) {
+        Worker& victim = *workers[p];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.queue.empty()) continue;
+        auto h = victim.queue.front();
+        victim.queue.pop_front();
+        w.steals++;
+        return h;
+      }
+      return {};
+    }
+
+    // Runs chunks until every chunk of the current kernel is done
+    void work(size_t w)
+    {
+      Worker& self = *workers[w];
+      while (remaining.load(std::memory_order_acquire) > 0) {
+        std::coroutine_handle<> h = pop(self);
+        if (!h && stealing.load(std::memory_order_relaxed)) h = steal(self);
+        if (h) h.resume();
+        else cpu_relax();
+      }
+    }
+
+    void worker_main(size_t w)
+    {
+      pin_to(workers[w]->cpu);
+      uint64_t seen = 0;
+      for (;;) {
+        // Spin for a while before sleeping, as the next kernel usually follows immediately
+        for (size_t i = 0; i < spin && epoch.load(std::memory_order_acquire) == seen; ++i)
+          cpu_relax();
+        epoch.wait(seen, std::memory_order_acquire);
+        seen = epoch.load(std::memory_order_acquire);
+        if (stop.load(std::memory_order_acquire)) return;
+        work(w);
+      }
+    }
+
+  public:
+    CoroScheduler(size_t n, size_t element_size) : n(n)
+    {
+      std::vector<int> cpus = allowed_cpus();
+      size_t nworkers = env_size("BABELSTREAM_CORO_THREADS", cpus.size());
+      spin = env_size("BABELSTREAM_CORO_SPIN", 1 << 16);
+
+      // Chunks are whole cache lines; by default eight per worker
+      size_t line = std::max<size_t>(1, CACHE_LINE / element_size);
+      chunk = env_size("BABELSTREAM_CORO_CHUNK", std::max<size_t>(1, n / (nworkers * 8)));
+      chunk = (chunk + line - 1) / line * line;
+      size_t nchunks = (n + chunk - 1) / chunk;
+
+      std::map<std::string, std::vector<size_t>> domains;
+      for (size_t w = 0; w < nworkers; ++w) {
+        workers.push_back(std::make_unique<Worker>());
+        Worker& worker = *workers.back();
+        worker.cpu = cpus[w % cpus.size()];
+        worker.first_chunk = nchunks * w / nworkers;
+        worker.last_chunk = nchunks * (w + 1) / nworkers;
+        domains[llc_domain(worker.cpu)].push_back(w);
+      }
+      // Each worker tries its domain peers starting with the next one, spreading thieves out
+      for (auto const& domain : domains) {
+        auto const& members = domain.second;
+        for (size_t i = 0; i < members.size(); ++i)
+          for (size_t j = 1; j < members.size(); ++j)
+            workers[members[i]]->peers.push_back(members[(i + j) % members.size()]);
+      }
+      num_domains = domains.size();
+
+      for (size_t k = 0; k < nchunks; ++k)
+        tasks.push_back(chunk_loop(k));
+
+#if defined(__linux__)
+      sched_getaffinity(0, sizeof(caller_mask), &caller_mask);
+#endif
+      pin_to(workers[0]->cpu);
+      for (size_t w = 1; w < nworkers; ++w)
+        workers[w]->thread = std::thread([this, w] { worker_main(w); });
+
+      std::cerr << "Coroutine runtime: " << nworkers << " workers in " << num_domains
+                << " LLC domain(s), " << nchunks << " chunks of " << chunk << " elements"
+                << std::endl;
+    }
+
+    ~CoroScheduler()
+    {
+      stop.store(true, std::memory_order_release);
+      epoch.fetch_add(1, std::memory_order_release);
+      epoch.notify_all();
+      for (auto& w : workers)
+        if (w->thread.joinable()) w->thread.join();
+      for (auto& t : tasks)
+        t.handle.destroy();
+#if defined(__linux__)
+      sched_setaffinity(0, sizeof(caller_mask), &caller_mask);
+#endif
+    }
+
+    size_t num_chunks() const { return tasks.size(); }
+
+    // Runs `k` on every chunk and returns once all are done
+    void run(Kernel k, bool steal)
+    {
+      kernel = k;
+      stealing.store(steal, std::memory_order_relaxed);
+      if (steal) stealable_runs += tasks.size();
+      remaining.store(tasks.size(), std::memory_order_release);
+      for (auto& w : workers) {
+        std::lock_guard<std::mutex> guard(w->lock);
+        for (size_t c = w->first_chunk; c < w->last_chunk; ++c)
+          w->queue.push_back(tasks[c].handle);
+      }
+      epoch.fetch_add(1, std::memory_order_release);
+      epoch.notify_all();
+      work(0);
+    }
+
+    void report(std::ostream& os) const
+    {
+      size_t steals = 0;
+      for (auto const& w : workers) steals += w->steals;
+      os << "Coroutine runtime: " << steals << " of " << stealable_runs
+         << " chunk runs were stolen within an LLC domain" << std::endl;
+    }
+};
+
+template <class T>
+CoroStream<T>::CoroStream(BenchId bs, const intptr_t array_size, const int device,
+                          T initA, T initB, T initC)
+  : array_size(array_size)
+{
+  if (device != 0)
+    throw std::runtime_error("Device != 0 is not supported by the coroutine runtime");
+
+  // The scheduler reads its environment first, so invalid values are rejected before anything
+  // is allocated
+  scheduler = std::make_unique<CoroScheduler>(array_size, sizeof(T));
+  partial.resize(scheduler->num_chunks());
+  char const* report_env = std::getenv("BABELSTREAM_CORO_REPORT");
+  report = report_env && std::string(report_env) == "1";
+
+  // Allocate on the host, only the arrays the selected benchmarks use; pages are first touched
+  // by the chunk owners in init_arrays
+  this->a = needs_buffer(bs, 'a') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+  this->b = needs_buffer(bs, 'b') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+  this->c = needs_buffer(bs, 'c') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+
+  init_arrays(initA, initB, initC);
+}
+
+template <class T>
+CoroStream<T>::~CoroStream()
+{
+  if (report) scheduler->report(std::cerr);
+  scheduler.reset();
+  free(a);
+  free(b);
+  free(c);
+}
+
+template <class T>
+template <typename F>
+void CoroStream<T>::parallel_chunks(F body, bool steal)
+{
+  CoroScheduler::Kernel kernel{&body, [](void* f, size_t chunk, size_t begin, size_t end) {
+    (*static_cast<F*>(f))(chunk, begin, end);
+  }};
+  scheduler->run(kernel, steal);
+}
+
+template <class T>
+void CoroStream<T>::init_arrays(T initA, T initB, T initC)
+{
+  // No stealing, so every chunk is first touched by its owner
+  parallel_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+    {
+      if (a) a[i] = initA;
+      if (b) b[i] = initB;
+      if (c) c[i] = initC;
+    }
+  }, false);
+}
+
+template <class T>
+void CoroStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
+{
+  h_a = a;
+  h_b = b;
+  h_c = c;
+}
+
+template <class T>
+void CoroStream<T>::copy()
+{
+  parallel_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      c[i] = a[i];
+  });
+}
+
+template <class T>
+void CoroStream<T>::mul()
+{
+  const T scalar = startScalar;
+  parallel_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      b[i] = scalar * c[i];
+  });
+}
+
+template <class T>
+void CoroStream<T>::add()
+{
+  parallel_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      c[i] = a[i] + b[i];
+  });
+}
+
+template <class T>
+void CoroStream<T>::triad()
+{
+  const T scalar = startScalar;
+  parallel_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      a[i] = b[i] + scalar * c[i];
+  });
+}
+
+template <class T>
+void CoroStream<T>::nstream()
+{
+  const T scalar = startScalar;
+  parallel_chunks([&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      a[i] += b[i] + scalar * c[i];
+  });
+}
+
+template <class T>
+T CoroStream<T>::dot()
+{
+  parallel_chunks([&](size_t chunk, size_t begin, size_t end) {
+    T sum{};
+    for (size_t i = begin; i < end; i++)
+      sum += a[i] * b[i];
+    partial[chunk] = sum;
+  });
+
+  T sum{};
+  for (T p : partial) sum += p;
+  return sum;
+}
+
+void listDevices(void)
+{
+  std::cout << "0: CPU" << std::endl;
+}
+
+std::string getDeviceName(const int)
+{
+  return std::string("Device name unavailable");
+}
+
+std::string getDeviceDriver(const int)
+{
+  return std::string("Device driver unavailable");
+}
+
+template class CoroStream<float>;
+template class CoroStream<double>;
@@ -0,0 +1,61 @@
+
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "Stream.h"
+
+#define IMPLEMENTATION_STRING "Coroutines"
+
+// Experimental locality-aware task runtime built on C++20 coroutines (see CoroStream.cpp)
+class CoroScheduler;
+
+template <class T>
+class CoroStream : public Stream<T>
+{
+  protected:
+    // Size of arrays
+    intptr_t array_size;
+
+    // Device side pointers
+    T *a;
+    T *b;
+    T *c;
+
+    // Worker threads, their deques and one coroutine per chunk of the arrays
+    std::unique_ptr<CoroScheduler> scheduler;
+
+    // Dot partial sums, one per chunk, added in chunk order so the result is deterministic
+    std::vector<T> partial;
+
+    // Print the steal counts on destruction, when enabled with BABELSTREAM_CORO_REPORT=1
+    bool report = false;
+
+    // Runs body(chunk, begin, end) for every chunk; without stealing each chunk runs on its owner
+    template <typename F>
+    void parallel_chunks(F body, bool steal = true);
+
+  public:
+    CoroStream(BenchId bs, const intptr_t array_size, const int device_id,
+               T initA, T initB, T initC);
+    ~CoroStream();
+
+    void copy() override;
+    void add() override;
+    void mul() override;
+    void triad() override;
+    void nstream() override;
+    T dot() override;
+
+    void get_arrays(T const*& a, T const*& b, T const*& c) override;
+    void init_arrays(T initA, T initB, T initC) override;
+};
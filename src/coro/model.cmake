@@ -0,0 +1,11 @@
+
+register_flag_optional(CMAKE_CXX_COMPILER
+        "Any CXX compiler with C++20 coroutine support"
+        "c++")
+
+macro(setup)
+    set(CMAKE_CXX_STANDARD 20)
+    set(THREADS_PREFER_PTHREAD_FLAG ON)
+    find_package(Threads REQUIRED)
+    register_link_library(Threads::Threads)
+endmacro()
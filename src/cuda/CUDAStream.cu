@@ -128,7 +128,8 @@ CUDAStream<T>::CUDAStream(BenchId bs, const intptr_t array_size, const int devic
   // Size of partial sums for dot kernels
   size_t sums_bytes = sizeof(T) * dot_num_blocks;
   size_t array_bytes = sizeof(T) * array_size;
-  size_t total_bytes = array_bytes * size_t(3) + sums_bytes;
+  size_t num_arrays = needs_buffer(bs, 'a') + needs_buffer(bs, 'b') + needs_buffer(bs, 'c');
+  size_t total_bytes = array_bytes * num_arrays + sums_bytes;
   std::cout << "Reduction kernel config: " << dot_num_blocks << " groups of (fixed) size " << TBSIZE_DOT << std::endl;
 
   // Check buffers fit on the device
@@ -138,10 +139,10 @@ CUDAStream<T>::CUDAStream(BenchId bs, const intptr_t array_size, const int devic
     throw std::runtime_error("Device does not have enough memory for all buffers");
   }
 
-  // Allocate buffers:
-  d_a = alloc_device<T>(array_size);
-  d_b = alloc_device<T>(array_size);
-  d_c = alloc_device<T>(array_size);
+  // Allocate buffers, only for the arrays the selected benchmarks use:
+  d_a = needs_buffer(bs, 'a') ? alloc_device<T>(array_size) : nullptr;
+  d_b = needs_buffer(bs, 'b') ? alloc_device<T>(array_size) : nullptr;
+  d_c = needs_buffer(bs, 'c') ? alloc_device<T>(array_size) : nullptr;
   sums = alloc_host<T>(dot_num_blocks);
 
   // Initialize buffers:
@@ -204,9 +205,9 @@ template <class T>
 void CUDAStream<T>::init_arrays(T initA, T initB, T initC)
 {
   for_each(array_size, [=,a=d_a,b=d_b,c=d_c] __device__ (size_t i) {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
+    if (a) a[i] = initA;
+    if (b) b[i] = initB;
+    if (c) c[i] = initC;
   });
 }
 
@@ -220,17 +221,16 @@ void CUDAStream<T>::get_arrays(T const*& a, T const*& b, T const*& c)
   b = d_b;
   c = d_c;
 #else
-  // No Unified memory: copy data to the host
-  size_t nbytes = array_size * sizeof(T);
-  h_a.resize(array_size);
-  h_b.resize(array_size);
-  h_c.resize(array_size);
-  a = h_a.data();
-  b = h_b.data();
-  c = h_c.data();
-  CU(cudaMemcpy(h_a.data(), d_a, nbytes, cudaMemcpyDeviceToHost));
-  CU(cudaMemcpy(h_b.data(), d_b, nbytes, cudaMemcpyDeviceToHost));
-  CU(cudaMemcpy(h_c.data(), d_c, nbytes, cudaMemcpyDeviceToHost));
+  // No Unified memory: copy the allocated arrays to the host
+  auto read = [&](T const* d, std::vector<T>& h) -> T const* {
+    if (!d) return nullptr;
+    h.resize(array_size);
+    CU(cudaMemcpy(h.data(), d, array_size * sizeof(T), cudaMemcpyDeviceToHost));
+    return h.data();
+  };
+  a = read(d_a, h_a);
+  b = read(d_b, h_b);
+  c = read(d_c, h_c);
 #endif
 }
 
@@ -2,6 +2,8 @@
 
 #include <cstdlib>
 #include <cstddef>
+#include <stdexcept>
+#include <string>
 
 #ifndef ALIGNMENT
 #define ALIGNMENT (2*1024*1024) // 2MB
@@ -33,9 +35,9 @@ void dealloc_raw(T *ptr) { sycl::free(ptr, exe_policy.queue()); }
 
 #else
 
-// auto exe_policy = dpl::execution::seq;
-// auto exe_policy = dpl::execution::par;
-static constexpr auto exe_policy = dpl::execution::par_unseq;
+namespace exe_ns = dpl::execution;
+#define HAS_UNSEQ_POLICY
+#define USE_HOST_POLICIES
 #define USE_STD_PTR_ALLOC_DEALLOC
 #define WORKAROUND
 
@@ -49,14 +51,64 @@ static constexpr auto exe_policy = dpl::execution::par_unseq;
 #include <execution>
 #include <numeric>
 
-// auto exe_policy = std::execution::seq;
-// auto exe_policy = std::execution::par;
-static constexpr auto exe_policy = std::execution::par_unseq;
+namespace exe_ns = std::execution;
+#if __cpp_lib_execution >= 201902L
+#define HAS_UNSEQ_POLICY
+#endif
+#define USE_HOST_POLICIES
 #define USE_STD_PTR_ALLOC_DEALLOC
 
 
 #endif
 
+// Host backends build every policy and pick one at runtime with BABELSTREAM_STD_POLICY; the
+// DPC++ backend only has its device policy
+enum class exe_policy_kind { seq, unseq, par, par_unseq };
+
+inline exe_policy_kind parse_exe_policy(std::string const& name)
+{
+  if (name == "par_unseq") return exe_policy_kind::par_unseq;
+#ifdef USE_HOST_POLICIES
+  if (name == "seq") return exe_policy_kind::seq;
+  if (name == "par") return exe_policy_kind::par;
+#ifdef HAS_UNSEQ_POLICY
+  if (name == "unseq") return exe_policy_kind::unseq;
+#else
+  if (name == "unseq") throw std::runtime_error("This standard library has no execution::unseq");
+#endif
+#endif
+  throw std::runtime_error("Unsupported execution policy: " + name);
+}
+
+inline char const* exe_policy_name(exe_policy_kind kind)
+{
+  switch (kind) {
+  case exe_policy_kind::seq:   return "seq";
+  case exe_policy_kind::unseq: return "unseq";
+  case exe_policy_kind::par:   return "par";
+  default:                     return "par_unseq";
+  }
+}
+
+// Calls f with the policy object for `kind`
+template <typename F>
+decltype(auto) with_exe_policy(exe_policy_kind kind, F&& f)
+{
+#ifdef USE_HOST_POLICIES
+  switch (kind) {
+  case exe_policy_kind::seq: return f(exe_ns::seq);
+#ifdef HAS_UNSEQ_POLICY
+  case exe_policy_kind::unseq: return f(exe_ns::unseq);
+#endif
+  case exe_policy_kind::par: return f(exe_ns::par);
+  default: return f(exe_ns::par_unseq);
+  }
+#else
+  (void)kind;
+  return f(exe_policy);
+#endif
+}
+
 #ifdef USE_STD_PTR_ALLOC_DEALLOC
 
 template<typename T>
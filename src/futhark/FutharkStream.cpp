@@ -6,6 +6,7 @@
 // For full license terms please see the LICENSE file distributed with this
 // source code
 
+#include <algorithm>
 #include <cstdlib>  // For aligned_alloc
 #include <string>
 #include "FutharkStream.h"
@@ -13,14 +14,33 @@
 template <class T>
 FutharkStream<T>::FutharkStream(BenchId bs, const intptr_t array_size, const int device,
 				T initA, T initB, T initC)
-  : array_size(array_size)
+  : array_size(array_size), bs(bs)
 {
+  // The environment is checked before the context is created, which a throw would leak
+  char const* env = std::getenv("BABELSTREAM_FUTHARK_ENTRIES");
+  if (env && *env) {
+    std::string entries(env);
+    if (entries == "inplace") this->inplace = true;
+    else if (entries == "fresh") this->inplace = false;
+    else throw std::runtime_error("Invalid BABELSTREAM_FUTHARK_ENTRIES: " + entries);
+  }
+  char const* classic_env = std::getenv("BABELSTREAM_FUTHARK_CLASSIC");
+  if (classic_env && *classic_env) {
+    std::string classic(classic_env);
+    if (classic == "1") this->fused = true;
+    else if (classic == "0") this->fused = false;
+    else throw std::runtime_error("Invalid BABELSTREAM_FUTHARK_CLASSIC: " + classic);
+  }
+
   this->cfg = futhark_context_config_new();
   this->device = "#" + std::to_string(device);
 #if defined(FUTHARK_BACKEND_cuda) || defined(FUTHARK_BACKEND_opencl)
   futhark_context_config_set_device(cfg, this->device.c_str());
 #endif
   this->ctx = futhark_context_new(cfg);
+  std::cerr << "Futhark entries: "
+            << (this->inplace ? "in place (unique destination arrays)" : "fresh result arrays")
+            << (this->fused ? ", fused classic for Classic passes" : "") << std::endl;
   this->a = NULL;
   this->b = NULL;
   this->c = NULL;
@@ -61,143 +81,199 @@ FutharkStream<double>::~FutharkStream()
 
 template <>
 void FutharkStream<float>::init_arrays(float initA, float initB, float initC) {
-  int array_size = this->array_size;
-  float *a = new float[array_size];
-  float *b = new float[array_size];
-  float *c = new float[array_size];
-  for (int i = 0; i < array_size; i++) {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
-  }
-  this->a = (futhark_f32_1d*)futhark_new_f32_1d(this->ctx, a, array_size);
-  this->b = (futhark_f32_1d*)futhark_new_f32_1d(this->ctx, b, array_size);
-  this->c = (futhark_f32_1d*)futhark_new_f32_1d(this->ctx, c, array_size);
+  // Only the arrays the selected benchmarks use are created; the others stay NULL. Arrays from
+  // an earlier call are replaced.
+  for (void* d : {this->a, this->b, this->c})
+    if (d) futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)d);
+  std::vector<float> host(array_size);
+  auto create = [&](char n, float init) -> void* {
+    if (!needs_buffer(bs, n)) return NULL;
+    std::fill(host.begin(), host.end(), init);
+    return futhark_new_f32_1d(this->ctx, host.data(), array_size);
+  };
+  this->a = create('a', initA);
+  this->b = create('b', initB);
+  this->c = create('c', initC);
   futhark_context_sync(this->ctx);
-  delete[] a;
-  delete[] b;
-  delete[] c;
 }
 
 template <>
 void FutharkStream<double>::init_arrays(double initA, double initB, double initC) {
-  int array_size = this->array_size;
-  double *a = new double[array_size];
-  double *b = new double[array_size];
-  double *c = new double[array_size];
-  for (int i = 0; i < array_size; i++) {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
-  }
-  this->a = (futhark_f64_1d*)futhark_new_f64_1d(this->ctx, a, array_size);
-  this->b = (futhark_f64_1d*)futhark_new_f64_1d(this->ctx, b, array_size);
-  this->c = (futhark_f64_1d*)futhark_new_f64_1d(this->ctx, c, array_size);
+  // Only the arrays the selected benchmarks use are created; the others stay NULL. Arrays from
+  // an earlier call are replaced.
+  for (void* d : {this->a, this->b, this->c})
+    if (d) futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)d);
+  std::vector<double> host(array_size);
+  auto create = [&](char n, double init) -> void* {
+    if (!needs_buffer(bs, n)) return NULL;
+    std::fill(host.begin(), host.end(), init);
+    return futhark_new_f64_1d(this->ctx, host.data(), array_size);
+  };
+  this->a = create('a', initA);
+  this->b = create('b', initB);
+  this->c = create('c', initC);
   futhark_context_sync(this->ctx);
-  delete[] a;
-  delete[] b;
-  delete[] c;
 }
 
 template <>
 void FutharkStream<float>::get_arrays(float const*& a_, float const*& b_, float const*& c_) {
-  h_a.resize(array_size);
-  h_b.resize(array_size);
-  h_c.resize(array_size);
-  futhark_values_f32_1d(this->ctx, (futhark_f32_1d*)this->a, h_a.data());
-  futhark_values_f32_1d(this->ctx, (futhark_f32_1d*)this->b, h_b.data());
-  futhark_values_f32_1d(this->ctx, (futhark_f32_1d*)this->c, h_c.data());
+  auto read = [&](void* d, std::vector<float>& h) -> float const* {
+    if (!d) return NULL;
+    h.resize(array_size);
+    futhark_values_f32_1d(this->ctx, (futhark_f32_1d*)d, h.data());
+    return h.data();
+  };
+  a_ = read(this->a, h_a);
+  b_ = read(this->b, h_b);
+  c_ = read(this->c, h_c);
   futhark_context_sync(this->ctx);
-  a_ = h_a.data();
-  b_ = h_b.data();
-  c_ = h_c.data();
 }
 
 template <>
 void FutharkStream<double>::get_arrays(double const*& a_, double const*& b_, double const*& c_) {
-  h_a.resize(array_size);
-  h_b.resize(array_size);
-  h_c.resize(array_size);
-  futhark_values_f64_1d(this->ctx, (futhark_f64_1d*)this->a, h_a.data());
-  futhark_values_f64_1d(this->ctx, (futhark_f64_1d*)this->b, h_b.data());
-  futhark_values_f64_1d(this->ctx, (futhark_f64_1d*)this->c, h_c.data());
+  auto read = [&](void* d, std::vector<double>& h) -> double const* {
+    if (!d) return NULL;
+    h.resize(array_size);
+    futhark_values_f64_1d(this->ctx, (futhark_f64_1d*)d, h.data());
+    return h.data();
+  };
+  a_ = read(this->a, h_a);
+  b_ = read(this->b, h_b);
+  c_ = read(this->c, h_c);
   futhark_context_sync(this->ctx);
-  a_ = h_a.data();
-  b_ = h_b.data();
-  c_ = h_c.data();
 }
 
 template <>
 void FutharkStream<float>::copy() {
-  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
-  futhark_entry_f32_copy(this->ctx, (futhark_f32_1d**)&this->c, (futhark_f32_1d*)this->a);
+  if (this->inplace) {
+    // The consumed c is still freed; its memory now backs the result
+    futhark_f32_1d* d;
+    futhark_entry_f32_copy_inplace(this->ctx, &d, (futhark_f32_1d*)this->c, (futhark_f32_1d*)this->a);
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
+    this->c = d;
+  } else {
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
+    futhark_entry_f32_copy(this->ctx, (futhark_f32_1d**)&this->c, (futhark_f32_1d*)this->a);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<double>::copy() {
-  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
-  futhark_entry_f64_copy(this->ctx, (futhark_f64_1d**)&this->c, (futhark_f64_1d*)this->a);
+  if (this->inplace) {
+    // The consumed c is still freed; its memory now backs the result
+    futhark_f64_1d* d;
+    futhark_entry_f64_copy_inplace(this->ctx, &d, (futhark_f64_1d*)this->c, (futhark_f64_1d*)this->a);
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
+    this->c = d;
+  } else {
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
+    futhark_entry_f64_copy(this->ctx, (futhark_f64_1d**)&this->c, (futhark_f64_1d*)this->a);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<float>::mul() {
-  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->b);
-  futhark_entry_f32_mul(this->ctx, (futhark_f32_1d**)&this->b, (futhark_f32_1d*)this->c);
+  if (this->inplace) {
+    futhark_f32_1d* d;
+    futhark_entry_f32_mul_inplace(this->ctx, &d, (futhark_f32_1d*)this->b, (futhark_f32_1d*)this->c);
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->b);
+    this->b = d;
+  } else {
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->b);
+    futhark_entry_f32_mul(this->ctx, (futhark_f32_1d**)&this->b, (futhark_f32_1d*)this->c);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<double>::mul() {
-  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->b);
-  futhark_entry_f64_mul(this->ctx, (futhark_f64_1d**)&this->b, (futhark_f64_1d*)this->c);
+  if (this->inplace) {
+    futhark_f64_1d* d;
+    futhark_entry_f64_mul_inplace(this->ctx, &d, (futhark_f64_1d*)this->b, (futhark_f64_1d*)this->c);
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->b);
+    this->b = d;
+  } else {
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->b);
+    futhark_entry_f64_mul(this->ctx, (futhark_f64_1d**)&this->b, (futhark_f64_1d*)this->c);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<float>::add() {
-  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
-  futhark_entry_f32_add(this->ctx, (futhark_f32_1d**)&this->c, (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b);
+  if (this->inplace) {
+    futhark_f32_1d* d;
+    futhark_entry_f32_add_inplace(this->ctx, &d, (futhark_f32_1d*)this->c, (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b);
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
+    this->c = d;
+  } else {
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
+    futhark_entry_f32_add(this->ctx, (futhark_f32_1d**)&this->c, (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<double>::add() {
-  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
-  futhark_entry_f64_add(this->ctx, (futhark_f64_1d**)&this->c, (futhark_f64_1d*)this->a, (futhark_f64_1d*)this->b);
+  if (this->inplace) {
+    futhark_f64_1d* d;
+    futhark_entry_f64_add_inplace(this->ctx, &d, (futhark_f64_1d*)this->c, (futhark_f64_1d*)this->a, (futhark_f64_1d*)this->b);
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
+    this->c = d;
+  } else {
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
+    futhark_entry_f64_add(this->ctx, (futhark_f64_1d**)&this->c, (futhark_f64_1d*)this->a, (futhark_f64_1d*)this->b);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<float>::triad() {
-  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
-  futhark_entry_f32_triad(this->ctx, (futhark_f32_1d**)&this->c, (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b);
+  if (this->inplace) {
+    futhark_f32_1d* d;
+    futhark_entry_f32_triad_inplace(this->ctx, &d, (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b, (futhark_f32_1d*)this->c);
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->a);
+    this->a = d;
+  } else {
+    futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->a);
+    futhark_entry_f32_triad(this->ctx, (futhark_f32_1d**)&this->a, (futhark_f32_1d*)this->b, (futhark_f32_1d*)this->c);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<double>::triad() {
-  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->a);
-  futhark_entry_f64_triad(this->ctx, (futhark_f64_1d**)&this->a, (futhark_f64_1d*)this->b, (futhark_f64_1d*)this->c);
+  if (this->inplace) {
+    futhark_f64_1d* d;
+    futhark_entry_f64_triad_inplace(this->ctx, &d, (futhark_f64_1d*)this->a, (futhark_f64_1d*)this->b, (futhark_f64_1d*)this->c);
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->a);
+    this->a = d;
+  } else {
+    futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->a);
+    futhark_entry_f64_triad(this->ctx, (futhark_f64_1d**)&this->a, (futhark_f64_1d*)this->b, (futhark_f64_1d*)this->c);
+  }
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<float>::nstream() {
+  // nstream consumes a, so it is always updated in place
   futhark_f32_1d* d;
-  futhark_entry_f32_triad(this->ctx, &d, (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b);
-  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
-  this->c = d;
+  futhark_entry_f32_nstream(this->ctx, &d, (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b, (futhark_f32_1d*)this->c);
+  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->a);
+  this->a = d;
   futhark_context_sync(this->ctx);
 }
 
 template <>
 void FutharkStream<double>::nstream() {
+  // nstream consumes a, so it is always updated in place
   futhark_f64_1d* d;
-  futhark_entry_f64_triad(this->ctx, &d, (futhark_f64_1d*)this->a, (futhark_f64_1d*)this->b);
-  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
-  this->c = d;
+  futhark_entry_f64_nstream(this->ctx, &d, (futhark_f64_1d*)this->a, (futhark_f64_1d*)this->b, (futhark_f64_1d*)this->c);
+  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->a);
+  this->a = d;
   futhark_context_sync(this->ctx);
 }
 
@@ -217,6 +293,36 @@ double FutharkStream<double>::dot() {
   return res;
 }
 
+template <>
+float FutharkStream<float>::classic() {
+  // The consumed arrays are still freed; their memory now backs the results
+  futhark_f32_1d *a, *b, *c;
+  futhark_entry_f32_classic(this->ctx, &a, &b, &c,
+                           (futhark_f32_1d*)this->a, (futhark_f32_1d*)this->b, (futhark_f32_1d*)this->c);
+  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->a);
+  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->b);
+  futhark_free_f32_1d(this->ctx, (futhark_f32_1d*)this->c);
+  this->a = a;
+  this->b = b;
+  this->c = c;
+  return dot();
+}
+
+template <>
+double FutharkStream<double>::classic() {
+  // The consumed arrays are still freed; their memory now backs the results
+  futhark_f64_1d *a, *b, *c;
+  futhark_entry_f64_classic(this->ctx, &a, &b, &c,
+                           (futhark_f64_1d*)this->a, (futhark_f64_1d*)this->b, (futhark_f64_1d*)this->c);
+  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->a);
+  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->b);
+  futhark_free_f64_1d(this->ctx, (futhark_f64_1d*)this->c);
+  this->a = a;
+  this->b = b;
+  this->c = c;
+  return dot();
+}
+
 void listDevices(void)
 {
   std::cout << "Device selection not supported." << std::endl;
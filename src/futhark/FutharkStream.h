@@ -44,6 +44,17 @@ protected:
   void* b;
   void* c;
 
+  // Benchmarks selected at construction; only the arrays they use are created
+  BenchId bs;
+
+  // Copy, Mul, Add and Triad call the *_inplace entry points, which consume the destination
+  // array and reuse its memory, rather than returning a new array that replaces it
+  bool inplace = true;
+
+  // With BABELSTREAM_FUTHARK_CLASSIC=1, the driver runs Classic passes through classic(), which
+  // calls the fused classic entry point and then Dot
+  bool fused = false;
+
   // Host side arrays for verification
   std::vector<T> h_a, h_b, h_c;
 
@@ -59,6 +70,9 @@ public:
   void nstream() override;
   T dot() override;
 
+  bool fused_classic() const override { return fused; }
+  T classic() override;
+
   void get_arrays(T const*& a, T const*& b, T const*& c) override;  
-  void init_arrays(T initA, T initB, T initC);
+  void init_arrays(T initA, T initB, T initC) override;
 };
@@ -50,7 +50,7 @@ macro(setup)
   endif()
 endmacro()
 
-macro(setup_target)
-  target_sources(${EXE_NAME} PUBLIC "${CMAKE_CURRENT_BINARY_DIR}/babelstream.c")
+macro(setup_target NAME)
+  target_sources(${NAME} PRIVATE "${CMAKE_CURRENT_BINARY_DIR}/babelstream.c")
   include_directories("${CMAKE_CURRENT_BINARY_DIR}")
 endmacro()
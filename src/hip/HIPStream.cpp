@@ -54,7 +54,9 @@ HIPStream<T>::HIPStream(BenchId bs, const intptr_t array_size, const int device_
 
   size_t array_bytes = sizeof(T);
   array_bytes *= array_size;
-  size_t total_bytes = array_bytes * std::size_t{3};
+  // Only the arrays the selected benchmarks use are allocated
+  std::size_t num_arrays = needs_buffer(bs, 'a') + needs_buffer(bs, 'b') + needs_buffer(bs, 'c');
+  size_t total_bytes = array_bytes * num_arrays;
 
   // Allocate the host array for partial sums for dot kernels using hipHostMalloc.
   // This creates an array on the host which is visible to the device. However, it requires
@@ -67,28 +69,26 @@ HIPStream<T>::HIPStream(BenchId bs, const intptr_t array_size, const int device_
   hipDeviceProp_t props;
   hipGetDeviceProperties(&props, 0);
   if (props.totalGlobalMem < total_bytes)
-    throw std::runtime_error("Device does not have enough memory for all 3 buffers");
+    throw std::runtime_error("Device does not have enough memory for all " + std::to_string(num_arrays) + " buffers");
 
   // Create device buffers
+  auto alloc = [&](char n) -> T* {
+    if (!needs_buffer(bs, n)) return nullptr;
+    T *p = nullptr;
 #if defined(MANAGED)
-  hipMallocManaged(&d_a, array_bytes);
-  check_error();
-  hipMallocManaged(&d_b, array_bytes);
-  check_error();
-  hipMallocManaged(&d_c, array_bytes);
-  check_error();
+    hipMallocManaged(&p, array_bytes);
+    check_error();
 #elif defined(PAGEFAULT)
-  d_a = (T*)malloc(array_bytes);
-  d_b = (T*)malloc(array_bytes);
-  d_c = (T*)malloc(array_bytes);
+    p = (T*)malloc(array_bytes);
 #else
-  hipMalloc(&d_a, array_bytes);
-  check_error();
-  hipMalloc(&d_b, array_bytes);
-  check_error();
-  hipMalloc(&d_c, array_bytes);
-  check_error();
+    hipMalloc(&p, array_bytes);
+    check_error();
 #endif
+    return p;
+  };
+  d_a = alloc('a');
+  d_b = alloc('b');
+  d_c = alloc('c');
 
   init_arrays(initA, initB, initC);
 }
@@ -113,9 +113,9 @@ template <typename T>
 __global__ void init_kernel(T * a, T * b, T * c, T initA, T initB, T initC, size_t array_size)
 {
   for (size_t i = (size_t)threadIdx.x + (size_t)blockDim.x * blockIdx.x; i < array_size; i += (size_t)gridDim.x * blockDim.x) {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
+    if (a) a[i] = initA;
+    if (b) b[i] = initB;
+    if (c) c[i] = initC;
   }
 }
 
@@ -139,20 +139,17 @@ void HIPStream<T>::get_arrays(T const*& a, T const*& b, T const*& c)
   b = d_b;
   c = d_c;
 #else
-  // No Unified memory: copy data to the host  
-  size_t nbytes = array_size * sizeof(T);
-  h_a.resize(array_size);
-  h_b.resize(array_size);
-  h_c.resize(array_size);
-  a = h_a.data();
-  b = h_b.data();
-  c = h_c.data();
-  hipMemcpy(h_a.data(), d_a, nbytes, hipMemcpyDeviceToHost);
-  check_error();
-  hipMemcpy(h_b.data(), d_b, nbytes, hipMemcpyDeviceToHost);
-  check_error();
-  hipMemcpy(h_c.data(), d_c, nbytes, hipMemcpyDeviceToHost);
-  check_error();
+  // No Unified memory: copy the allocated arrays to the host
+  auto read = [&](T const* d, std::vector<T>& h) -> T const* {
+    if (!d) return nullptr;
+    h.resize(array_size);
+    hipMemcpy(h.data(), d, array_size * sizeof(T), hipMemcpyDeviceToHost);
+    check_error();
+    return h.data();
+  };
+  a = read(d_a, h_a);
+  b = read(d_b, h_b);
+  c = read(d_c, h_c);
 #endif
 }
 
@@ -1,3 +1,4 @@
+
 // Copyright (c) 2015-23 Tom Deakin, Simon McIntosh-Smith, Wei-Chen (Tom) Lin
 // University of Bristol HPC
 //
@@ -7,22 +8,329 @@
 
 #include "KokkosStream.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+  char const* env_string(char const* name)
+  {
+    char const* env = std::getenv(name);
+    return env && *env ? env : nullptr;
+  }
+
+  long env_long(char const* name, long fallback)
+  {
+    char const* env = env_string(name);
+    if (!env) return fallback;
+    char* end = nullptr;
+    long value = std::strtol(env, &end, 10);
+    if (*end != '\0' || value < 0)
+      throw std::runtime_error(std::string("Invalid ") + name + ": " + env);
+    return value;
+  }
+}
+
+template <class T>
+struct KokkosArrays
+{
+  virtual ~KokkosArrays() {}
+  virtual void init(T initA, T initB, T initC) = 0;
+  virtual void copy() = 0;
+  virtual void mul() = 0;
+  virtual void add() = 0;
+  virtual void triad() = 0;
+  virtual void nstream() = 0;
+  virtual T dot() = 0;
+  // Returns true when the arrays were read in place rather than copied to host mirrors
+  virtual bool get_arrays(T const*& a, T const*& b, T const*& c) = 0;
+  virtual char const* space_name() const = 0;
+  virtual long vector_length_max() const = 0;
+};
+
+// Kernels are member templates over the view type, so the same code runs with and without
+// MemoryTraits<Restrict | Aligned>. Everything is public: CUDA's extended lambdas cannot be
+// defined in private or protected member functions.
+template <class T, class ExecSpace, class MemSpace>
+struct KokkosSpaceArrays : KokkosArrays<T>
+{
+  using View = Kokkos::View<T*, MemSpace>;
+  using RestrictView = Kokkos::View<T*, MemSpace, Kokkos::MemoryTraits<Kokkos::Restrict | Kokkos::Aligned>>;
+  // HostSpace, SharedSpace and the memory of host backends can be read without a copy
+  static constexpr bool host_accessible = Kokkos::SpaceAccessibility<Kokkos::HostSpace, MemSpace>::accessible;
+
+  const long array_size;
+  KokkosOptions const& options;
+  View d_a, d_b, d_c;
+  // Only allocated when the arrays are not host accessible
+  typename View::HostMirror hm_a, hm_b, hm_c;
+
+  KokkosSpaceArrays(BenchId bs, long array_size, KokkosOptions const& options)
+    : array_size(array_size), options(options)
+  {
+    // Arrays the selected benchmarks do not use are left empty
+    auto extent = [&](char n) { return needs_buffer(bs, n) ? array_size : 0; };
+    d_a = View(Kokkos::ViewAllocateWithoutInitializing("d_a"), extent('a'));
+    d_b = View(Kokkos::ViewAllocateWithoutInitializing("d_b"), extent('b'));
+    d_c = View(Kokkos::ViewAllocateWithoutInitializing("d_c"), extent('c'));
+    if (!host_accessible)
+    {
+      hm_a = Kokkos::create_mirror_view(d_a);
+      hm_b = Kokkos::create_mirror_view(d_b);
+      hm_c = Kokkos::create_mirror_view(d_c);
+    }
+  }
+
+  // Runs body(i) for every element with the selected policy
+  template <class F>
+  void for_each(F const& body) const
+  {
+    const long n = array_size;
+    if (options.policy == KokkosOptions::Policy::Team)
+    {
+      using policy_t = Kokkos::TeamPolicy<ExecSpace>;
+      using member_t = typename policy_t::member_type;
+      const long per_team = options.team_elements;
+      const long vl = options.vector_length;
+      const int league = (int)((n + per_team - 1) / per_team);
+      policy_t policy = options.team_size ? policy_t(league, (int)options.team_size, (int)vl)
+                                          : policy_t(league, Kokkos::AUTO, (int)vl);
+      Kokkos::parallel_for(policy, KOKKOS_LAMBDA (const member_t& m)
+      {
+        const long begin = m.league_rank() * per_team;
+        const long end = begin + per_team < n ? begin + per_team : n;
+        Kokkos::parallel_for(Kokkos::TeamThreadRange(m, (end - begin + vl - 1) / vl), [&](const long row)
+        {
+          Kokkos::parallel_for(Kokkos::ThreadVectorRange(m, vl), [&](const long lane)
+          {
+            const long i = begin + row * vl + lane;
+            if (i < end) body(i);
+          });
+        });
+      });
+    }
+    else if (options.dynamic)
+    {
+      Kokkos::RangePolicy<ExecSpace, Kokkos::Schedule<Kokkos::Dynamic>, Kokkos::IndexType<long>> policy(0, n);
+      if (options.chunk) policy.set_chunk_size(options.chunk);
+      Kokkos::parallel_for(policy, KOKKOS_LAMBDA (const long i) { body(i); });
+    }
+    else
+    {
+      Kokkos::RangePolicy<ExecSpace, Kokkos::Schedule<Kokkos::Static>, Kokkos::IndexType<long>> policy(0, n);
+      if (options.chunk) policy.set_chunk_size(options.chunk);
+      Kokkos::parallel_for(policy, KOKKOS_LAMBDA (const long i) { body(i); });
+    }
+    Kokkos::fence();
+  }
+
+  // Sum of body(i) over every element with the selected policy
+  template <class F>
+  T reduce(F const& body) const
+  {
+    const long n = array_size;
+    T sum{};
+    if (options.policy == KokkosOptions::Policy::Team)
+    {
+      using policy_t = Kokkos::TeamPolicy<ExecSpace>;
+      using member_t = typename policy_t::member_type;
+      const long per_team = options.team_elements;
+      const long vl = options.vector_length;
+      const int league = (int)((n + per_team - 1) / per_team);
+      policy_t policy = options.team_size ? policy_t(league, (int)options.team_size, (int)vl)
+                                          : policy_t(league, Kokkos::AUTO, (int)vl);
+      Kokkos::parallel_reduce(policy, KOKKOS_LAMBDA (const member_t& m, T& total)
+      {
+        const long begin = m.league_rank() * per_team;
+        const long end = begin + per_team < n ? begin + per_team : n;
+        T team_sum{};
+        Kokkos::parallel_reduce(Kokkos::TeamThreadRange(m, (end - begin + vl - 1) / vl), [&](const long row, T& row_acc)
+        {
+          T row_sum{};
+          Kokkos::parallel_reduce(Kokkos::ThreadVectorRange(m, vl), [&](const long lane, T& acc)
+          {
+            const long i = begin + row * vl + lane;
+            if (i < end) acc += body(i);
+          }, row_sum);
+          row_acc += row_sum;
+        }, team_sum);
+        Kokkos::single(Kokkos::PerTeam(m), [&]() { total += team_sum; });
+      }, sum);
+    }
+    else if (options.dynamic)
+    {
+      Kokkos::RangePolicy<ExecSpace, Kokkos::Schedule<Kokkos::Dynamic>, Kokkos::IndexType<long>> policy(0, n);
+      if (options.chunk) policy.set_chunk_size(options.chunk);
+      Kokkos::parallel_reduce(policy, KOKKOS_LAMBDA (const long i, T& tmp) { tmp += body(i); }, sum);
+    }
+    else
+    {
+      Kokkos::RangePolicy<ExecSpace, Kokkos::Schedule<Kokkos::Static>, Kokkos::IndexType<long>> policy(0, n);
+      if (options.chunk) policy.set_chunk_size(options.chunk);
+      Kokkos::parallel_reduce(policy, KOKKOS_LAMBDA (const long i, T& tmp) { tmp += body(i); }, sum);
+    }
+    return sum;
+  }
+
+  template <class V>
+  void init_as(T initA, T initB, T initC)
+  {
+    V a = d_a, b = d_b, c = d_c;
+    const bool use_a = a.extent(0) > 0, use_b = b.extent(0) > 0, use_c = c.extent(0) > 0;
+    // Initialised with the kernels' policy, so pages are first touched where they are used
+    for_each(KOKKOS_LAMBDA (const long i)
+    {
+      if (use_a) a[i] = initA;
+      if (use_b) b[i] = initB;
+      if (use_c) c[i] = initC;
+    });
+  }
+
+  template <class V>
+  void copy_as()
+  {
+    V a = d_a, c = d_c;
+    for_each(KOKKOS_LAMBDA (const long i) { c[i] = a[i]; });
+  }
+
+  template <class V>
+  void mul_as()
+  {
+    V b = d_b, c = d_c;
+    const T scalar = startScalar;
+    for_each(KOKKOS_LAMBDA (const long i) { b[i] = scalar*c[i]; });
+  }
+
+  template <class V>
+  void add_as()
+  {
+    V a = d_a, b = d_b, c = d_c;
+    for_each(KOKKOS_LAMBDA (const long i) { c[i] = a[i] + b[i]; });
+  }
+
+  template <class V>
+  void triad_as()
+  {
+    V a = d_a, b = d_b, c = d_c;
+    const T scalar = startScalar;
+    for_each(KOKKOS_LAMBDA (const long i) { a[i] = b[i] + scalar*c[i]; });
+  }
+
+  template <class V>
+  void nstream_as()
+  {
+    V a = d_a, b = d_b, c = d_c;
+    const T scalar = startScalar;
+    for_each(KOKKOS_LAMBDA (const long i) { a[i] += b[i] + scalar*c[i]; });
+  }
+
+  template <class V>
+  T dot_as()
+  {
+    V a = d_a, b = d_b;
+    return reduce(KOKKOS_LAMBDA (const long i) { return a[i] * b[i]; });
+  }
+
+  void init(T initA, T initB, T initC) override
+  {
+    options.restrict_views ? init_as<RestrictView>(initA, initB, initC) : init_as<View>(initA, initB, initC);
+  }
+  void copy() override { options.restrict_views ? copy_as<RestrictView>() : copy_as<View>(); }
+  void mul() override { options.restrict_views ? mul_as<RestrictView>() : mul_as<View>(); }
+  void add() override { options.restrict_views ? add_as<RestrictView>() : add_as<View>(); }
+  void triad() override { options.restrict_views ? triad_as<RestrictView>() : triad_as<View>(); }
+  void nstream() override { options.restrict_views ? nstream_as<RestrictView>() : nstream_as<View>(); }
+  T dot() override { return options.restrict_views ? dot_as<RestrictView>() : dot_as<View>(); }
+
+  bool get_arrays(T const*& a, T const*& b, T const*& c) override
+  {
+    auto read = [](View const& d, typename View::HostMirror& h) -> T const* {
+      if (!d.extent(0)) return nullptr;
+      if (host_accessible) return d.data();
+      Kokkos::deep_copy(h, d);
+      return h.data();
+    };
+    // Kernels end with a fence, so the arrays are complete when read in place
+    a = read(d_a, hm_a);
+    b = read(d_b, hm_b);
+    c = read(d_c, hm_c);
+    return host_accessible;
+  }
+
+  char const* space_name() const override { return MemSpace::name(); }
+  long vector_length_max() const override { return Kokkos::TeamPolicy<ExecSpace>::vector_length_max(); }
+};
+
 template <class T>
 KokkosStream<T>::KokkosStream(BenchId bs, const intptr_t array_size, const int device_index,
 			      T initA, T initB, T initC)
     : array_size(array_size)
 {
-  Kokkos::initialize(Kokkos::InitializationSettings().set_device_id(device_index));
+  if (char const* env = env_string("BABELSTREAM_KOKKOS_POLICY"))
+  {
+    std::string policy(env);
+    if (policy == "range") options.policy = KokkosOptions::Policy::Range;
+    else if (policy == "team") options.policy = KokkosOptions::Policy::Team;
+    else throw std::runtime_error("Invalid BABELSTREAM_KOKKOS_POLICY: " + policy);
+  }
+  if (char const* env = env_string("BABELSTREAM_KOKKOS_SCHEDULE"))
+  {
+    std::string schedule(env);
+    if (schedule == "static") options.dynamic = false;
+    else if (schedule == "dynamic") options.dynamic = true;
+    else throw std::runtime_error("Invalid BABELSTREAM_KOKKOS_SCHEDULE: " + schedule);
+  }
+  options.chunk = env_long("BABELSTREAM_KOKKOS_CHUNK", options.chunk);
+  options.team_size = env_long("BABELSTREAM_KOKKOS_TEAM_SIZE", options.team_size);
+  options.vector_length = std::max(env_long("BABELSTREAM_KOKKOS_VECTOR_LENGTH", options.vector_length), 1L);
+  options.team_elements = std::max(env_long("BABELSTREAM_KOKKOS_TEAM_ELEMENTS", options.team_elements), 1L);
+  options.restrict_views = env_long("BABELSTREAM_KOKKOS_RESTRICT", 0) != 0;
+  if (char const* env = env_string("BABELSTREAM_KOKKOS_SPACE"))
+  {
+    std::string space(env);
+    if (space == "default") options.space = KokkosOptions::Space::Default;
+    else if (space == "host") options.space = KokkosOptions::Space::Host;
+    else if (space == "shared") options.space = KokkosOptions::Space::Shared;
+    else throw std::runtime_error("Invalid BABELSTREAM_KOKKOS_SPACE: " + space);
+  }
+
+  // Kokkos can only be initialised once per process, and a process can construct more than one
+  // stream (e.g. --model all), so it is finalised at exit rather than with the stream
+  if (!Kokkos::is_initialized())
+  {
+    Kokkos::initialize(Kokkos::InitializationSettings().set_device_id(device_index));
+    std::atexit([] { if (Kokkos::is_initialized()) Kokkos::finalize(); });
+  }
+
+  switch (options.space)
+  {
+  case KokkosOptions::Space::Host:
+    arrays.reset(new KokkosSpaceArrays<T, Kokkos::DefaultHostExecutionSpace, Kokkos::HostSpace>(bs, array_size, options));
+    break;
+  case KokkosOptions::Space::Shared:
+#ifdef KOKKOS_HAS_SHARED_SPACE
+    arrays.reset(new KokkosSpaceArrays<T, Kokkos::DefaultExecutionSpace, Kokkos::SharedSpace>(bs, array_size, options));
+    break;
+#else
+    throw std::runtime_error("BABELSTREAM_KOKKOS_SPACE=shared requires Kokkos 4 with a SharedSpace");
+#endif
+  default:
+    arrays.reset(new KokkosSpaceArrays<T, Kokkos::DefaultExecutionSpace,
+                                       Kokkos::DefaultExecutionSpace::memory_space>(bs, array_size, options));
+  }
 
-  d_a = new Kokkos::View<T*>(Kokkos::ViewAllocateWithoutInitializing("d_a"), array_size);
-  d_b = new Kokkos::View<T*>(Kokkos::ViewAllocateWithoutInitializing("d_b"), array_size);
-  d_c = new Kokkos::View<T*>(Kokkos::ViewAllocateWithoutInitializing("d_c"), array_size);
-  hm_a = new typename Kokkos::View<T*>::HostMirror();
-  hm_b = new typename Kokkos::View<T*>::HostMirror();
-  hm_c = new typename Kokkos::View<T*>::HostMirror();
-  *hm_a = create_mirror_view(*d_a);
-  *hm_b = create_mirror_view(*d_b);
-  *hm_c = create_mirror_view(*d_c);
+  std::cerr << "Kokkos policy: ";
+  if (options.policy == KokkosOptions::Policy::Team)
+    std::cerr << "TeamPolicy, team size " << (options.team_size ? std::to_string(options.team_size) : "auto")
+              << ", vector length " << options.vector_length << ", " << options.team_elements << " elements per team";
+  else
+    std::cerr << "RangePolicy, " << (options.dynamic ? "dynamic" : "static") << " schedule, chunk "
+              << (options.chunk ? std::to_string(options.chunk) : "default");
+  std::cerr << std::endl;
+  std::cerr << "Kokkos memory space: " << arrays->space_name()
+            << (options.restrict_views ? ", MemoryTraits<Restrict | Aligned>" : "") << std::endl;
 
   init_arrays(initA, initB, initC);
 }
@@ -30,123 +338,84 @@ KokkosStream<T>::KokkosStream(BenchId bs, const intptr_t array_size, const int d
 template <class T>
 KokkosStream<T>::~KokkosStream()
 {
-  Kokkos::finalize();
+  // Views must be released before Kokkos is finalised
+  arrays.reset();
 }
 
 template <class T>
 void KokkosStream<T>::init_arrays(T initA, T initB, T initC)
 {
-  Kokkos::View<T*> a(*d_a);
-  Kokkos::View<T*> b(*d_b);
-  Kokkos::View<T*> c(*d_c);
-  Kokkos::parallel_for(array_size, KOKKOS_LAMBDA (const long index)
-  {
-    a[index] = initA;
-    b[index] = initB;
-    c[index] = initC;
-  });
-  Kokkos::fence();
+  arrays->init(initA, initB, initC);
 }
 
 template <class T>
 void KokkosStream<T>::get_arrays(T const*& a, T const*& b, T const*& c)
 {
-  deep_copy(*hm_a, *d_a);
-  deep_copy(*hm_b, *d_b);
-  deep_copy(*hm_c, *d_c);
-  a = hm_a->data();
-  b = hm_b->data();
-  c = hm_c->data();
+  auto t1 = std::chrono::high_resolution_clock::now();
+  bool in_place = arrays->get_arrays(a, b, c);
+  auto t2 = std::chrono::high_resolution_clock::now();
+  std::cerr << "Kokkos read-back: " << std::chrono::duration<double>(t2 - t1).count() << " s"
+            << (in_place ? " (host accessible, no copy)" : " (deep_copy to host mirrors)") << std::endl;
 }
 
 template <class T>
 void KokkosStream<T>::copy()
 {
-  Kokkos::View<T*> a(*d_a);
-  Kokkos::View<T*> b(*d_b);
-  Kokkos::View<T*> c(*d_c);
-
-  Kokkos::parallel_for(array_size, KOKKOS_LAMBDA (const long index)
-  {
-    c[index] = a[index];
-  });
-  Kokkos::fence();
+  arrays->copy();
 }
 
 template <class T>
 void KokkosStream<T>::mul()
 {
-  Kokkos::View<T*> a(*d_a);
-  Kokkos::View<T*> b(*d_b);
-  Kokkos::View<T*> c(*d_c);
-
-  const T scalar = startScalar;
-  Kokkos::parallel_for(array_size, KOKKOS_LAMBDA (const long index)
-  {
-    b[index] = scalar*c[index];
-  });
-  Kokkos::fence();
+  arrays->mul();
 }
 
 template <class T>
 void KokkosStream<T>::add()
 {
-  Kokkos::View<T*> a(*d_a);
-  Kokkos::View<T*> b(*d_b);
-  Kokkos::View<T*> c(*d_c);
-
-  Kokkos::parallel_for(array_size, KOKKOS_LAMBDA (const long index)
-  {
-    c[index] = a[index] + b[index];
-  });
-  Kokkos::fence();
+  arrays->add();
 }
 
 template <class T>
 void KokkosStream<T>::triad()
 {
-  Kokkos::View<T*> a(*d_a);
-  Kokkos::View<T*> b(*d_b);
-  Kokkos::View<T*> c(*d_c);
-
-  const T scalar = startScalar;
-  Kokkos::parallel_for(array_size, KOKKOS_LAMBDA (const long index)
-  {
-    a[index] = b[index] + scalar*c[index];
-  });
-  Kokkos::fence();
+  arrays->triad();
 }
 
 template <class T>
 void KokkosStream<T>::nstream()
 {
-  Kokkos::View<T*> a(*d_a);
-  Kokkos::View<T*> b(*d_b);
-  Kokkos::View<T*> c(*d_c);
-
-  const T scalar = startScalar;
-  Kokkos::parallel_for(array_size, KOKKOS_LAMBDA (const long index)
-  {
-    a[index] += b[index] + scalar*c[index];
-  });
-  Kokkos::fence();
+  arrays->nstream();
 }
 
 template <class T>
 T KokkosStream<T>::dot()
 {
-  Kokkos::View<T*> a(*d_a);
-  Kokkos::View<T*> b(*d_b);
-
-  T sum{};
+  return arrays->dot();
+}
 
-  Kokkos::parallel_reduce(array_size, KOKKOS_LAMBDA (const long index, T &tmp)
+template <class T>
+std::vector<TuneParam> KokkosStream<T>::tune_space()
+{
+  if (options.policy == KokkosOptions::Policy::Team)
   {
-    tmp += a[index] * b[index];
-  }, sum);
-
-  return sum;
+    TuneParam vl{"vector_length", {1}};
+    for (long v : {4, 8, 16, 32})
+      if (v <= arrays->vector_length_max())
+        vl.values.push_back(v);
+    return {{"team_elements", {1024, 4096, 16384, 65536}}, vl};
+  }
+  // 0 keeps Kokkos' default chunk
+  return {{"dynamic", {0, 1}}, {"chunk", {0, 1024, 16384, 65536}}};
+}
 
+template <class T>
+void KokkosStream<T>::set_tune_param(std::string const& name, long value)
+{
+  if (name == "dynamic") options.dynamic = value != 0;
+  else if (name == "chunk") options.chunk = value;
+  else if (name == "team_elements") options.team_elements = std::max(value, 1L);
+  else if (name == "vector_length") options.vector_length = std::max(value, 1L);
 }
 
 void listDevices(void)
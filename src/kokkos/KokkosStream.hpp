@@ -7,6 +7,7 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 
 #include <Kokkos_Core.hpp>
@@ -14,6 +15,31 @@
 
 #define IMPLEMENTATION_STRING "Kokkos"
 
+// How the kernels are dispatched and where the arrays live, from the BABELSTREAM_KOKKOS_*
+// environment variables (see the README)
+struct KokkosOptions
+{
+  // Flat RangePolicy, or a TeamPolicy in which each team covers `team_elements` contiguous
+  // elements as rows of `vector_length`, split over TeamThreadRange and ThreadVectorRange
+  enum class Policy {Range, Team} policy = Policy::Range;
+  // RangePolicy schedule and chunk size; a chunk of 0 keeps Kokkos' default
+  bool dynamic = false;
+  long chunk = 0;
+  // TeamPolicy shape; a team size of 0 is Kokkos::AUTO
+  long team_size = 0;
+  long vector_length = 1;
+  long team_elements = 4096;
+  // Access the arrays through MemoryTraits<Restrict | Aligned> views
+  bool restrict_views = false;
+  // Default: the default execution space's memory space. Host: HostSpace, run on the default
+  // host execution space. Shared: SharedSpace (Kokkos 4+), run on the default execution space.
+  enum class Space {Default, Host, Shared} space = Space::Default;
+};
+
+// The arrays and kernels for one execution and memory space (see KokkosStream.cpp)
+template <class T>
+struct KokkosArrays;
+
 template <class T>
 class KokkosStream : public Stream<T>
 {
@@ -21,13 +47,10 @@ class KokkosStream : public Stream<T>
     // Size of arrays
     intptr_t array_size;
 
-    // Device side pointers to arrays
-    typename Kokkos::View<T*>* d_a;
-    typename Kokkos::View<T*>* d_b;
-    typename Kokkos::View<T*>* d_c;
-    typename Kokkos::View<T*>::HostMirror* hm_a;
-    typename Kokkos::View<T*>::HostMirror* hm_b;
-    typename Kokkos::View<T*>::HostMirror* hm_c;
+    KokkosOptions options;
+
+    // Device side arrays and their host mirrors
+    std::unique_ptr<KokkosArrays<T>> arrays;
 
   public:
 
@@ -43,6 +66,9 @@ class KokkosStream : public Stream<T>
     T dot() override;
 
     void get_arrays(T const*& a, T const*& b, T const*& c) override;
-    void init_arrays(T initA, T initB, T initC);
-};
+    void init_arrays(T initA, T initB, T initC) override;
 
+    // RangePolicy chunk and schedule, or TeamPolicy elements per team and vector length
+    std::vector<TuneParam> tune_space() override;
+    void set_tune_param(std::string const& name, long value) override;
+};
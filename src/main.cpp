@@ -10,18 +10,28 @@
 #include <chrono>
 #include <cmath>
 #include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <numeric>
+#include <sstream>
 #include <vector>
 
 #define VERSION_STRING "5.0"
 
-#include "Stream.h"
+#include "BabelStream.h"
 
 #include "StreamModels.h"
 #include "Unit.h"
+#include "MultiInstance.h"
+#include "StreamPlugin.h"
+#include "Results.h"
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
 
 #ifdef ENABLE_CALIPER
 #include <caliper/cali.h>
@@ -40,6 +50,30 @@ bool output_as_csv = false;
 Unit unit{Unit::Kind::MegaByte};
 bool silence_errors = false;
 std::string csv_separator = ",";
+// Run the complex-valued AoS vs SoA kernels instead of the real-valued ones
+bool run_complex_layouts = false;
+// Number of independent benchmark processes sharing the node
+size_t num_instances = 1;
+char** program_argv = nullptr;
+#ifdef MULTI_INSTANCE_SUPPORTED
+// Set when this process is one of the instances launched by --instances
+std::unique_ptr<InstanceGroup> instance_group;
+#endif
+// Models loaded with --model; when empty the model built into this executable is used
+std::vector<StreamPlugin const*> plugins;
+// Plugin being run, or nullptr for the built-in model
+StreamPlugin const* current_plugin = nullptr;
+bool list_devices_only = false;
+// Machine-readable results output and baseline comparison
+std::string json_path;
+std::string compare_path;
+// Bandwidth loss, in percent, tolerated before a kernel counts as a regression
+double tolerance = 5.0;
+// Every result row printed so far, for --json and --compare
+std::vector<KernelRecord> records;
+// Rank of this process and number of ranks when built with USE_MPI
+int mpi_rank = 0;
+int mpi_size = 1;
 
 // Selected benchmarks to run: default is all 5 classic benchmarks.
 BenchId selection = BenchId::Classic;
@@ -47,19 +81,49 @@ BenchId selection = BenchId::Classic;
 // Returns true if the benchmark needs to be run:
 bool run_benchmark(Benchmark const& b) { return run_benchmark(selection, b); }
 
-// Benchmark run order
-// - Classic: runs each bench once in the order above, and repeats n times.
-// - Isolated: runs each bench n times in isolation
-enum class BenchOrder : int {Classic, Isolated};
 BenchOrder order = BenchOrder::Classic;
 
+// Kernels submitted back-to-back per timed sample with --batch
+size_t batch = 1;
+
+// Search of the model's parameters with --tune, and the values it chose for the model being run
+babelstream::TuneMethod tune_method = babelstream::TuneMethod::None;
+size_t tune_trials = 3;
+std::vector<babelstream::TunedParam> tuned_params;
+
+// Return false when the run failed, e.g. on a validation error
 template <typename T>
-void run();
+bool run();
+
+template <typename T>
+bool run_complex();
 
 void parseArguments(int argc, char *argv[]);
 
+bool compare_with_baseline();
+
+// Aligns the start of a timed region across instances and MPI ranks;
+// no-op unless running with --instances or on more than one rank
+void sync_instances()
+{
+#ifdef MULTI_INSTANCE_SUPPORTED
+  if (instance_group) instance_group->barrier();
+#endif
+#ifdef USE_MPI
+  if (mpi_size > 1) MPI_Barrier(MPI_COMM_WORLD);
+#endif
+}
+
 int main(int argc, char *argv[])
 {
+#ifdef USE_MPI
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+  // Only rank 0 reports; errors still go to std::cerr on every rank
+  if (mpi_rank != 0) std::cout.setstate(std::ios::failbit);
+#endif
+
 #ifdef ENABLE_CALIPER
   	cali::ConfigManager calimgr;
 
@@ -84,159 +148,356 @@ int main(int argc, char *argv[])
 #endif  
 
   parseArguments(argc, argv);
+  program_argv = argv;
+
+  if (list_devices_only)
+  {
+    if (plugins.empty())
+      listDevices();
+    for (auto p : plugins)
+    {
+      std::cout << p->implementation << " (" << p->model << "):" << std::endl;
+      p->list_devices();
+    }
+    std::exit(EXIT_SUCCESS);
+  }
+
+  if (!plugins.empty() && run_complex_layouts)
+  {
+    std::cerr << "--complex cannot be combined with --model" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (run_complex_layouts && selection != BenchId::All && selection != BenchId::Classic &&
+      selection != BenchId::Triad && selection != BenchId::Dot)
+  {
+    std::cerr << "--complex only implements the Triad and Dot kernels" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (run_complex_layouts && batch > 1)
+  {
+    std::cerr << "--complex cannot be combined with --batch" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (run_complex_layouts && tune_method != babelstream::TuneMethod::None)
+  {
+    std::cerr << "--complex cannot be combined with --tune" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (plugins.size() > 1 && num_instances > 1)
+  {
+    std::cerr << "--instances can only be combined with a single --model" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (run_complex_layouts && num_instances > 1)
+  {
+    std::cerr << "--complex cannot be combined with --instances" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (mpi_size > 1 && (num_instances > 1 || run_complex_layouts))
+  {
+    if (mpi_rank == 0)
+      std::cerr << "--instances and --complex cannot be used with more than one MPI rank" << std::endl;
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif
+    return EXIT_FAILURE;
+  }
+
+#ifdef MULTI_INSTANCE_SUPPORTED
+  if (char const* id = std::getenv(INSTANCE_ENV_ID))
+  {
+    try {
+      instance_group = std::make_unique<InstanceGroup>(std::getenv(INSTANCE_ENV_SHM), std::atoll(id));
+    } catch (std::exception const& e) {
+      std::cerr << "Instance " << id << ": " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+#endif
 
   if (!output_as_csv)
   {
     std::cout
       << "BabelStream" << std::endl
-      << "Version: " << VERSION_STRING << std::endl
-      << "Implementation: " << IMPLEMENTATION_STRING << std::endl;
+      << "Version: " << VERSION_STRING << std::endl;
+    if (plugins.empty())
+      std::cout << "Implementation: " << IMPLEMENTATION_STRING << std::endl;
+    if (num_instances > 1)
+      std::cout << "Instances: " << num_instances << std::endl;
+    if (mpi_size > 1)
+      std::cout << "MPI ranks: " << mpi_size << std::endl;
   }
 
-  if (use_float)
-    run<float>();
+  bool valid = true;
+  if (run_complex_layouts)
+  {
+    if (use_float)
+      valid = run_complex<float>();
+    else
+      valid = run_complex<double>();
+  }
+  else if (plugins.empty())
+  {
+    if (use_float)
+      valid = run<float>();
+    else
+      valid = run<double>();
+  }
   else
-    run<double>();
+  {
+    // Run each loaded model back-to-back in this process
+    for (size_t m = 0; m < plugins.size(); ++m)
+    {
+      current_plugin = plugins[m];
+      if (!output_as_csv)
+        std::cout << (m == 0 ? "" : "\n") << "Implementation: " << current_plugin->implementation
+                  << " (" << current_plugin->model << ")" << std::endl;
+      if (use_float)
+        valid = run<float>() && valid;
+      else
+        valid = run<double>() && valid;
+    }
+  }
+
+  // Only the process that printed results records them
+  bool reporting = mpi_rank == 0;
+#ifdef MULTI_INSTANCE_SUPPORTED
+  reporting = reporting && !instance_group;
+#endif
+  // A validation failure fails the run like a regression, after MPI has been finalised
+  bool regressed = !valid;
+  if (reporting && !json_path.empty())
+  {
+    std::ofstream out(json_path);
+    write_json(out, VERSION_STRING, records);
+    if (!out)
+    {
+      std::cerr << "Failed to write " << json_path << std::endl;
+      regressed = true;
+    }
+  }
+  if (reporting && !compare_path.empty())
+    regressed = compare_with_baseline() || regressed;
 
 #ifdef ENABLE_CALIPER
     adiak::fini();
     calimgr.flush();
 #endif
-  return EXIT_SUCCESS;
+#ifdef USE_MPI
+  int local = regressed, any = 0;
+  MPI_Allreduce(&local, &any, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  regressed = any;
+  MPI_Finalize();
+#endif
+  return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
-// Returns duration of executing function f:
-template <typename F>
-double time(F&& f) {
-  using clk_t = std::chrono::high_resolution_clock;
-  using dur_t = std::chrono::duration<double>;
-  auto start = clk_t::now();
-  f();
-  return dur_t(clk_t::now() - start).count();
+// Library configuration matching the command line options
+babelstream::Config config()
+{
+  babelstream::Config c;
+  c.array_size = array_size;
+  c.num_times = num_times;
+  c.device_index = deviceIndex;
+  c.selection = selection;
+  c.order = order;
+  c.batch = batch;
+  c.tune = tune_method;
+  c.tune_trials = tune_trials;
+  c.before_kernel = sync_instances;
+  return c;
 }
 
-// Run specified kernels
-template <typename T>
-std::vector<std::vector<double>> run_all(std::unique_ptr<Stream<T>>& stream, T& sum)
-{
-  // Times for each measured benchmark:
-  std::vector<std::vector<double>> timings(num_benchmarks);
+// Formatting utilities:
+// `group_column` names the leading column of multi-instance/MPI csv output
+void fmt_csv_header(char const* group_column = nullptr) {
+  if (current_plugin) std::cout << "model" << csv_separator;
+  if (group_column) std::cout << group_column << csv_separator;
+  std::cout
+    << "function" << csv_separator
+    << "num_times" << csv_separator
+    << "n_elements" << csv_separator
+    << "sizeof" << csv_separator
+    << "max_" << unit.str() << "_per_sec" << csv_separator
+    << "min_runtime" << csv_separator
+    << "max_runtime" << csv_separator
+    << "avg_runtime" << std::endl;
+}
 
-  // Run a particular benchmark
-  auto run = [&](Benchmark const& b)
-  {
-    switch(b.id) {
-    case BenchId::Copy:    return stream->copy();
-    case BenchId::Mul:     return stream->mul();
-    case BenchId::Add:     return stream->add();
-    case BenchId::Triad:   return stream->triad();
-    case BenchId::Dot:     sum = stream->dot(); return;
-    case BenchId::Nstream: return stream->nstream();
-    default:
-      std::cerr << "Unimplemented benchmark: " << b.label << std::endl;
-      abort();
-    }
-  };
+void fmt_cli_header() {
+  std::cout
+    << std::left << std::setw(16) << "Function"
+    << std::left << std::setw(12) << (std::string(unit.str()) + "/s")
+    << std::left << std::setw(12) << "Min (sec)"
+    << std::left << std::setw(12) << "Max"
+    << std::left << std::setw(12) << "Average"
+    << std::endl
+    << std::fixed;
+}
+
+void fmt_csv(char const* function, size_t num_times, size_t num_elements,
+             size_t type_size, double bandwidth,
+             double dt_min, double dt_max, double dt_avg, char const* group) {
+  if (current_plugin) std::cout << current_plugin->model << csv_separator;
+  if (group) std::cout << group << csv_separator;
+  std::cout << function << csv_separator
+       << num_times << csv_separator
+       << num_elements << csv_separator
+       << type_size << csv_separator
+       << bandwidth << csv_separator
+       << dt_min << csv_separator
+       << dt_max << csv_separator
+       << dt_avg << std::endl;
+}
+
+void fmt_cli(char const* function, double bandwidth,
+             double dt_min, double dt_max, double dt_avg) {
+  std::cout
+    << std::left << std::setw(16) << function
+    << std::left << std::setw(12) << std::setprecision(3) << bandwidth
+    << std::left << std::setw(12) << std::setprecision(5) << dt_min
+    << std::left << std::setw(12) << std::setprecision(5) << dt_max
+    << std::left << std::setw(12) << std::setprecision(5) << dt_avg
+    << std::endl;
+}
 
-  // Time a particular benchmark:
-  auto dt = [&](Benchmark const& b) { return time([&] { run(b); }); };
+void fmt_result(char const* function, size_t num_times, size_t num_elements,
+                size_t type_size, double bandwidth,
+                double dt_min, double dt_max, double dt_avg, char const* group = nullptr) {
+  if (!output_as_csv) return fmt_cli(function, bandwidth, dt_min, dt_max, dt_avg);
+  fmt_csv(function, num_times, num_elements, type_size, bandwidth, dt_min, dt_max, dt_avg, group);
+}
+
+// Displays min/max/average of the timings of one kernel moving `bytes` per run.
+// `group` labels the row in multi-instance/MPI csv output.
+void fmt_timings(char const* function, size_t type_size, double bytes, std::vector<double> const& timings,
+                 char const* group = nullptr) {
+  KernelRecord record;
+  record.model = current_plugin ? current_plugin->implementation : IMPLEMENTATION_STRING;
+  record.group = group ? group : "";
+  record.function = function;
+  record.order = order == BenchOrder::Isolated ? "Isolated" : "Classic";
+  // Batched timings are not comparable with blocking ones, so they never match such a baseline
+  if (batch > 1) record.order += " batch " + std::to_string(batch);
+  record.type_size = type_size;
+  record.n_elements = array_size;
+  record.bytes = bytes;
+  record.timings = timings;
+  for (auto const& p : tuned_params)
+    record.tuned.emplace_back(p.name, p.str());
+  records.push_back(record);
 
-  // Reserve timings:
-  for (size_t i = 0; i < num_benchmarks; ++i) {
-    if (!run_benchmark(bench[i])) continue;
-    timings[i].reserve(num_times);
+  auto s = babelstream::summarise(timings);
+  fmt_result(function, num_times, array_size, type_size,
+             unit.fmt(bytes / s.min), s.min, s.max, s.avg, group);
+}
+
+// Prints results for a group of concurrently running benchmarks (instances or MPI ranks):
+// one table per member, then the aggregate over all members.
+// timings_of(n, i) returns member n's timings of row i of run_all(); rows that were not run
+// hold zeros.
+template <typename T, typename F>
+void fmt_group(char const* member, char const* column, size_t members, F&& timings_of)
+{
+  using babelstream::num_rows;
+  using babelstream::row_label;
+  using babelstream::row_weight;
+
+  if (output_as_csv) fmt_csv_header(column);
+
+  std::vector<bool> ran(num_rows);
+  for (size_t i = 0; i < num_rows; ++i)
+  {
+    auto t = timings_of(0, i);
+    ran[i] = std::any_of(t.begin(), t.end(), [](double d) { return d != 0.0; });
   }
 
-  switch(order) {
-  // Classic runs each benchmark once in the order specifies in the "bench" array above,
-  // and then repeats num_times:
-  case BenchOrder::Classic: {
-    for (size_t k = 0; k < num_times; k++) {
-      for (size_t i = 0; i < num_benchmarks; ++i) {
-	if (!run_benchmark(bench[i])) continue;
-#ifdef ENABLE_CALIPER
-    CALI_MARK_BEGIN(bench[i].label);
-#endif 
-	timings[i].push_back(dt(bench[i]));
-#ifdef ENABLE_CALIPER
-    CALI_MARK_END(bench[i].label);
-#endif 
-      }
+  for (size_t n = 0; n < members; ++n)
+  {
+    auto label = std::to_string(n);
+    if (!output_as_csv)
+    {
+      std::cout << std::endl << member << " " << n << std::endl;
+      fmt_cli_header();
     }
-    break;
-  }
-  // Isolated runs each benchmark num_times, before proceeding to run the next benchmark:
-  case BenchOrder::Isolated: {
-    for (size_t i = 0; i < num_benchmarks; ++i) {
-      if (!run_benchmark(bench[i])) continue;
-      auto t = time([&] { for (size_t k = 0; k < num_times; k++) run(bench[i]); });
-      timings[i].resize(num_times, t / (double)num_times);
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+      if (!ran[i]) continue;
+      fmt_timings(row_label(i), sizeof(T), row_weight(i) * sizeof(T) * array_size,
+                  timings_of(n, i), label.c_str());
     }
-    break;
-  }
-  default:
-    std::cerr << "Unimplemented order" << std::endl;
-    abort();
   }
 
-  // Compiler should use a move
-  return timings;
+  // Members start each timed region together, so the aggregate of a run is the data moved by
+  // all members over the time taken by the slowest one.
+  if (!output_as_csv)
+  {
+    std::cout << std::endl << "Aggregate (" << members << " " << column << "s)" << std::endl;
+    fmt_cli_header();
+  }
+  for (size_t i = 0; i < num_rows; ++i)
+  {
+    if (!ran[i]) continue;
+    std::vector<double> slowest(num_times, 0.0);
+    for (size_t n = 0; n < members; ++n)
+    {
+      auto t = timings_of(n, i);
+      for (size_t k = 0; k < num_times; ++k)
+        slowest[k] = std::max(slowest[k], t[k]);
+    }
+    fmt_timings(row_label(i), sizeof(T), members * row_weight(i) * sizeof(T) * array_size,
+                slowest, "all");
+  }
 }
 
+#ifdef MULTI_INSTANCE_SUPPORTED
+// Launches num_instances copies of this benchmark, each bound to its own CPUs and NUMA node(s),
+// and prints per-instance results followed by the aggregate over all instances.
 template <typename T>
-void check_solution(const size_t ntimes, T const* a, T const* b, T const* c, T sum);
+void run_instances()
+{
+  std::vector<InstancePlacement> placements;
+  std::unique_ptr<InstanceGroup> group;
+  try {
+    placements = plan_instances(num_instances);
+    group = std::make_unique<InstanceGroup>(num_instances, babelstream::num_rows * num_times);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  if (!output_as_csv)
+  {
+    for (size_t n = 0; n < num_instances; ++n)
+      std::cout << "Instance " << n << ": CPUs " << id_list_string(placements[n].cpus)
+                << ", NUMA node(s) "
+                << (placements[n].nodes.empty() ? "unknown" : id_list_string(placements[n].nodes))
+                << std::endl;
+  }
+
+  if (!group->launch(placements, program_argv))
+    std::exit(EXIT_FAILURE);
+
+  fmt_group<T>("Instance", "instance", num_instances, [&](size_t n, size_t i) {
+    double const* t = group->slots(n) + i * num_times;
+    return std::vector<double>(t, t + num_times);
+  });
+}
+#endif
 
 // Generic run routine
 // Runs the kernel(s) and prints output.
 template <typename T>
-void run()
+bool run()
 {
   std::streamsize ss = std::cout.precision();
 
-  // Formatting utilities:
-  auto fmt_bw = [&](size_t weight, double dt) {
-    return unit.fmt((weight * sizeof(T) * array_size)/dt);
-  };
-  auto fmt_csv_header = [] {
-    std::cout
-      << "function" << csv_separator
-      << "num_times" << csv_separator
-      << "n_elements" << csv_separator
-      << "sizeof" << csv_separator
-      << "max_" << unit.str() << "_per_sec" << csv_separator
-      << "min_runtime" << csv_separator
-      << "max_runtime" << csv_separator
-      << "avg_runtime" << std::endl;
-  };
-  auto fmt_csv = [](char const* function, size_t num_times, size_t num_elements,
-                    size_t type_size, double bandwidth,
-		    double dt_min, double dt_max, double dt_avg) {
-    std::cout << function << csv_separator
-         << num_times << csv_separator
-         << num_elements << csv_separator
-         << type_size << csv_separator
-         << bandwidth << csv_separator
-         << dt_min << csv_separator
-         << dt_max << csv_separator
-         << dt_avg << std::endl;
-  };
-  auto fmt_cli = [](char const* function, double bandwidth,
-		    double dt_min, double dt_max, double dt_avg) {
-    std::cout
-      << std::left << std::setw(12) << function
-      << std::left << std::setw(12) << std::setprecision(3) << bandwidth
-      << std::left << std::setw(12) << std::setprecision(5) << dt_min
-      << std::left << std::setw(12) << std::setprecision(5) << dt_max
-      << std::left << std::setw(12) << std::setprecision(5) << dt_avg
-      << std::endl;
-  };
-  auto fmt_result = [&](char const* function, size_t num_times, size_t num_elements,
-                        size_t type_size, double bandwidth,
-			double dt_min, double dt_max, double dt_avg) {
-    if (!output_as_csv) return fmt_cli(function, bandwidth, dt_min, dt_max, dt_avg);
-    fmt_csv(function, num_times, num_elements, type_size, bandwidth, dt_min, dt_max, dt_avg);
-  };
-
   if (!output_as_csv)
   {
     std::cout << "Running ";
@@ -260,106 +521,214 @@ void run()
     default: std::cerr << "Error: Unknown order" << std::endl; abort();
     };
     std::cout << " order " << std::endl;
+    if (batch > 1)
+      std::cout << "Batch: " << batch << " kernels submitted per timed sample" << std::endl;
     std::cout << "Number of elements: " << array_size << std::endl;
     std::cout << "Precision: " << (sizeof(T) == sizeof(float)? "float" : "double") << std::endl;
 
     size_t nbytes = array_size * sizeof(T);
     std::cout << std::setprecision(1) << std::fixed
 	      << "Array size: " << unit.fmt(nbytes) << " " << unit.str() << std::endl;
-    std::cout << "Total size: " << unit.fmt(3.0*nbytes) << " " << unit.str() << std::endl;
+    // Models only allocate the arrays the selected benchmarks use
+    int narrays = needs_buffer(selection, 'a') + needs_buffer(selection, 'b') + needs_buffer(selection, 'c');
+    std::cout << "Total size: " << unit.fmt(narrays*nbytes) << " " << unit.str() << std::endl;
     std::cout.precision(ss);
   }
 
-  std::unique_ptr<Stream<T>> stream
-    = make_stream<T>(selection, array_size, deviceIndex, startA, startB, startC);
-  
-  // Result of the Dot kernel, if used.
-  T sum{};
-  std::vector<std::vector<double>> timings = run_all<T>(stream, sum);
+#ifdef MULTI_INSTANCE_SUPPORTED
+  if (num_instances > 1 && !instance_group)
+  {
+    run_instances<T>();
+    return true;
+  }
+#endif
+
+  babelstream::TuneResult tuned;
+  std::unique_ptr<Stream<T>> stream;
+  // Models reject invalid options, such as BABELSTREAM_* values, by throwing
+  try {
+    stream = babelstream::make_tuned<T>(config(), [&] {
+      return current_plugin
+        ? current_plugin->make_stream<T>(selection, array_size, deviceIndex, startA, startB, startC)
+        : make_stream<T>(selection, array_size, deviceIndex, startA, startB, startC);
+    }, tuned);
+  } catch (std::exception const& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return false;
+  }
+  tuned_params = tuned.best;
+  if (tune_method != babelstream::TuneMethod::None && !output_as_csv)
+  {
+    if (tuned.best.empty())
+      std::cout << "Tuning: the model declares no tunable parameters" << std::endl;
+    else
+    {
+      std::cout << "Tuned over " << tuned.points << " points:";
+      for (auto const& p : tuned.best)
+        std::cout << " " << p.name << "=" << p.str();
+      std::cout << std::endl;
+    }
+  }
+
+  if (babelstream::runs_fused<T>(config(), *stream) && !output_as_csv)
+    std::cout << "Fused: each Classic pass is timed as one sample, reported as Classic (fused)"
+              << std::endl;
 
-  // Create & read host vectors:
-  T const* a;
-  T const* b;
-  T const* c;
-  stream->get_arrays(a, b, c);
+  auto results = babelstream::run<T>(config(), *stream);
+  const bool valid = results.validation_failures == 0 || silence_errors;
+  // Other ranks wait for this one's timings, so with MPI a failed rank still takes part
+  if (!valid && mpi_size <= 1)
+    return false;
+  auto const& timings = results.timings;
 
-  check_solution<T>(num_times, a, b, c, sum);
+#ifdef MULTI_INSTANCE_SUPPORTED
+  // Instances hand their timings back to the launching process instead of printing them
+  if (instance_group)
+  {
+    double* slots = instance_group->slots(instance_group->instance_id());
+    for (size_t i = 0; i < babelstream::num_rows; ++i)
+      std::copy(timings[i].begin(), timings[i].end(), slots + i * num_times);
+    return valid;
+  }
+#endif
 
-  if (output_as_csv)
+#ifdef USE_MPI
+  // Rank 0 gathers every rank's timings; the aggregate uses the slowest rank of each run
+  if (mpi_size > 1)
   {
-    fmt_csv_header();
+    std::vector<double> local(babelstream::num_rows * num_times, 0.0);
+    for (size_t i = 0; i < babelstream::num_rows; ++i)
+      std::copy(timings[i].begin(), timings[i].end(), local.begin() + i * num_times);
+    std::vector<double> all(mpi_rank == 0 ? local.size() * mpi_size : 0);
+    MPI_Gather(local.data(), (int)local.size(), MPI_DOUBLE,
+               all.data(), (int)local.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (mpi_rank == 0)
+      fmt_group<T>("Rank", "rank", mpi_size, [&](size_t n, size_t i) {
+        double const* t = all.data() + (n * babelstream::num_rows + i) * num_times;
+        return std::vector<double>(t, t + num_times);
+      });
+    return valid;
   }
+#endif
+
+  if (output_as_csv)
+    fmt_csv_header();
   else
+    fmt_cli_header();
+
+  for (size_t i = 0; i < babelstream::num_rows; ++i)
   {
-    std::cout
-      << std::left << std::setw(12) << "Function"
-      << std::left << std::setw(12) << (std::string(unit.str()) + "/s")
-      << std::left << std::setw(12) << "Min (sec)"
-      << std::left << std::setw(12) << "Max"
-      << std::left << std::setw(12) << "Average"
-      << std::endl
-      << std::fixed;
+    if (timings[i].empty()) continue;
+    fmt_timings(babelstream::row_label(i), sizeof(T),
+                babelstream::row_weight(i) * sizeof(T) * array_size, timings[i]);
   }
+  return valid;
+}
 
-  for (size_t i = 0; i < num_benchmarks; ++i)
-  {
-    if (!run_benchmark(bench[i])) continue;
+// Complex-valued kernels, in the order in which they are run:
+struct ComplexBenchmark {
+  // Real-valued kernel this is a variant of, for --only
+  BenchId id;
+  char const* label;
+  // Weight counts complex elements moved each loop iteration, as in Benchmark::weight
+  size_t weight;
+};
+constexpr size_t num_complex_benchmarks = 4;
+constexpr std::array<ComplexBenchmark, num_complex_benchmarks> complex_bench = {
+  ComplexBenchmark { .id = BenchId::Triad, .label = "Triad (AoS)", .weight = 3 },
+  ComplexBenchmark { .id = BenchId::Dot,   .label = "Dot (AoS)",   .weight = 2 },
+  ComplexBenchmark { .id = BenchId::Triad, .label = "Triad (SoA)", .weight = 3 },
+  ComplexBenchmark { .id = BenchId::Dot,   .label = "Dot (SoA)",   .weight = 2 }
+};
 
-    // Get min/max; ignore the first result
-    auto minmax = std::minmax_element(timings[i].begin()+1, timings[i].end());
+// Returns true if the complex benchmark was selected with --only
+bool run_complex_benchmark(ComplexBenchmark const& b)
+{
+  return selection == BenchId::All || selection == BenchId::Classic || selection == b.id;
+}
+
+template <typename T>
+bool check_complex_solution(ComplexStream<T>& stream, std::complex<T> sum_aos, std::complex<T> sum_soa,
+                            std::complex<T> initA, std::complex<T> initB, std::complex<T> initC);
+
+// Runs the complex-valued Triad and Dot kernels in both AoS and SoA layouts and prints output.
+template <typename T>
+bool run_complex()
+{
+  std::streamsize ss = std::cout.precision();
+
+  using C = std::complex<T>;
+  const C initA(startA, startB);
+  const C initB(startB, startA);
+  const C initC(startA, startA);
 
-    // Calculate average; ignore the first result
-    double average = std::accumulate(timings[i].begin()+1, timings[i].end(), 0.0)
-      / (double)(num_times - 1);
+  if (!output_as_csv)
+  {
+    std::cout << "Running complex Triad and Dot kernels in AoS and SoA layouts "
+              << num_times << " times in ";
+    switch (order) {
+    case BenchOrder::Classic: std::cout << " Classic"; break;
+    case BenchOrder::Isolated: std::cout << " Isolated"; break;
+    default: std::cerr << "Error: Unknown order" << std::endl; abort();
+    };
+    std::cout << " order " << std::endl;
+    std::cout << "Number of elements: " << array_size << std::endl;
+    std::cout << "Precision: complex<" << (sizeof(T) == sizeof(float)? "float" : "double") << ">" << std::endl;
 
-    // Display results
-    fmt_result(bench[i].label, num_times, array_size, sizeof(T),
-	       fmt_bw(bench[i].weight, *minmax.first), *minmax.first, *minmax.second, average);
+    size_t nbytes = array_size * sizeof(C);
+    std::cout << std::setprecision(1) << std::fixed
+	      << "Array size: " << unit.fmt(nbytes) << " " << unit.str() << std::endl;
+    // 3 arrays for each of the two layouts
+    std::cout << "Total size: " << unit.fmt(6.0*nbytes) << " " << unit.str() << std::endl;
+    std::cout.precision(ss);
   }
-}
 
-template <typename T>
-void check_solution(const size_t num_times, T const* a, T const* b, T const* c, T sum) {
-  // Generate correct solution
-  T goldA = startA;
-  T goldB = startB;
-  T goldC = startC;
-  T goldS = T(0.);
-
-  const T scalar = startScalar;
-
-  // Updates output due to running each benchmark:
-  auto run = [&](int b) {
-    switch(bench[b].id) {
-    case BenchId::Copy:    goldC = goldA; break;
-    case BenchId::Mul:     goldB = scalar * goldC; break;
-    case BenchId::Add:     goldC = goldA + goldB; break;
-    case BenchId::Triad:   goldA = goldB + scalar * goldC; break;
-    case BenchId::Nstream: goldA += goldB + scalar * goldC; break;
-    case BenchId::Dot:     goldS = goldA * goldB * T(array_size); break; // This calculates the answer exactly
+  std::unique_ptr<ComplexStream<T>> stream;
+  try {
+    stream = make_complex_stream<T>(array_size, (int)deviceIndex, initA, initB, initC);
+  } catch (std::exception const& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return false;
+  }
+  if (!stream)
+  {
+    std::cerr << "Complex benchmarks are not implemented for " << IMPLEMENTATION_STRING << std::endl;
+    return false;
+  }
+
+  // Results of the Dot kernels
+  C sum_aos{};
+  C sum_soa{};
+
+  auto run = [&](size_t i)
+  {
+    switch(i) {
+    case 0: return stream->triad_aos();
+    case 1: sum_aos = stream->dot_aos(); return;
+    case 2: return stream->triad_soa();
+    case 3: sum_soa = stream->dot_soa(); return;
     default:
-    std::cerr << "Unimplemented Check: " << bench[b].label << std::endl;
-    abort();
+      std::cerr << "Unimplemented benchmark: " << complex_bench[i].label << std::endl;
+      abort();
     }
   };
 
+  std::vector<std::vector<double>> timings(num_complex_benchmarks);
+  for (auto& t : timings) t.reserve(num_times);
+
   switch(order) {
-  // Classic runs each benchmark once in the order specifies in the "bench" array above,
-  // and then repeats num_times:
   case BenchOrder::Classic: {
-    for (size_t k = 0; k < num_times; k++) {
-      for (size_t i = 0; i < num_benchmarks; ++i) {
-	      if (!run_benchmark(bench[i])) continue;
-	      run(i);
-      }
-    }
+    for (size_t k = 0; k < num_times; k++)
+      for (size_t i = 0; i < num_complex_benchmarks; ++i)
+        if (run_complex_benchmark(complex_bench[i]))
+          timings[i].push_back(babelstream::time([&] { run(i); }));
     break;
   }
-  // Isolated runs each benchmark num_times, before proceeding to run the next benchmark:
   case BenchOrder::Isolated: {
-    for (size_t i = 0; i < num_benchmarks; ++i) {
-      if (!run_benchmark(bench[i])) continue;
-      for (size_t k = 0; k < num_times; k++) run(i);
+    for (size_t i = 0; i < num_complex_benchmarks; ++i) {
+      if (!run_complex_benchmark(complex_bench[i])) continue;
+      auto t = babelstream::time([&] { for (size_t k = 0; k < num_times; k++) run(i); });
+      timings[i].resize(num_times, t / (double)num_times);
     }
     break;
   }
@@ -368,46 +737,161 @@ void check_solution(const size_t num_times, T const* a, T const* b, T const* c,
     abort();
   }
 
-  // Error relative tolerance check - a higher tolerance is used for reductions.
+  if (!check_complex_solution<T>(*stream, sum_aos, sum_soa, initA, initB, initC))
+    return false;
+
+  if (output_as_csv)
+    fmt_csv_header();
+  else
+    fmt_cli_header();
+
+  for (size_t i = 0; i < num_complex_benchmarks; ++i)
+    if (run_complex_benchmark(complex_bench[i]))
+      fmt_timings(complex_bench[i].label, sizeof(C), complex_bench[i].weight * sizeof(C) * array_size, timings[i]);
+  return true;
+}
+
+template <typename T>
+bool check_complex_solution(ComplexStream<T>& stream, std::complex<T> sum_aos, std::complex<T> sum_soa,
+                            std::complex<T> initA, std::complex<T> initB, std::complex<T> initC)
+{
+  using C = std::complex<T>;
+
+  // Triad only depends on the unchanged b and c, so a single application is exact
+  const C scalar = complexScalar<T>();
+  const C goldA = selection == BenchId::Dot ? initA : initB + scalar * initC;
+  const C goldB = initB;
+  const C goldC = initC;
+  const C goldS = goldA * goldB * T(array_size);
+
   size_t failed = 0;
   T max_rel = std::numeric_limits<T>::epsilon() * T(100.0);
   T max_rel_dot = std::numeric_limits<T>::epsilon() * T(10000000.0);
   auto check = [&](const char* name, T is, T should, T mrel, size_t i = size_t(-1)) {
-    // Relative difference:
     T diff = std::abs(is - should);
-    T abs_is = std::abs(is);
-    T abs_sh = std::abs(should);
-    T largest = std::max(abs_is, abs_sh);
-    T same = diff <= largest * mrel;
-    if (!same || std::isnan(is)) {
+    T largest = std::max(std::abs(is), std::abs(should));
+    if (!(diff <= largest * mrel) || std::isnan(is)) {
       ++failed;
       if (failed > 10) return;
       std::cerr << "FAILED validation of " << name;
       if (i != size_t(-1)) std::cerr << "[" << i << "]";
       std::cerr << ": " << is << " (is) != " << should
 		<< " (should)" << ", diff=" << diff << " > "
-		<< largest * mrel << " (largest=" << largest
-		<< ", max_rel=" << mrel << ")" << std::endl;
+		<< largest * mrel << std::endl;
     }
   };
 
-  // Sum
-  for (size_t i = 0; i < num_benchmarks; ++i) {
-    if (bench[i].id != BenchId::Dot) continue;
-    if (run_benchmark(bench[i]))
-      check("sum", sum, goldS, max_rel_dot);
-    break;
+  if (selection != BenchId::Triad) {
+    check("sum_aos.re", sum_aos.real(), goldS.real(), max_rel_dot);
+    check("sum_aos.im", sum_aos.imag(), goldS.imag(), max_rel_dot);
+    check("sum_soa.re", sum_soa.real(), goldS.real(), max_rel_dot);
+    check("sum_soa.im", sum_soa.imag(), goldS.imag(), max_rel_dot);
   }
 
-  // Calculate the L^infty-norm relative error
-  for (size_t i = 0; i < array_size; ++i) {
-    check("a", a[i], goldA, max_rel, i);
-    check("b", b[i], goldB, max_rel, i);
-    check("c", c[i], goldC, max_rel, i);
+  C const *a, *b, *c;
+  stream.get_arrays_aos(a, b, c);
+  for (intptr_t i = 0; i < array_size; ++i) {
+    check("a_aos.re", a[i].real(), goldA.real(), max_rel, i);
+    check("a_aos.im", a[i].imag(), goldA.imag(), max_rel, i);
+    check("b_aos.re", b[i].real(), goldB.real(), max_rel, i);
+    check("b_aos.im", b[i].imag(), goldB.imag(), max_rel, i);
+    check("c_aos.re", c[i].real(), goldC.real(), max_rel, i);
+    check("c_aos.im", c[i].imag(), goldC.imag(), max_rel, i);
   }
 
-  if (failed > 0 && !silence_errors)
-    std::exit(EXIT_FAILURE);
+  T const *a_re, *a_im, *b_re, *b_im, *c_re, *c_im;
+  stream.get_arrays_soa(a_re, a_im, b_re, b_im, c_re, c_im);
+  for (intptr_t i = 0; i < array_size; ++i) {
+    check("a_soa.re", a_re[i], goldA.real(), max_rel, i);
+    check("a_soa.im", a_im[i], goldA.imag(), max_rel, i);
+    check("b_soa.re", b_re[i], goldB.real(), max_rel, i);
+    check("b_soa.im", b_im[i], goldB.imag(), max_rel, i);
+    check("c_soa.re", c_re[i], goldC.real(), max_rel, i);
+    check("c_soa.im", c_im[i], goldC.imag(), max_rel, i);
+  }
+
+  return failed == 0 || silence_errors;
+}
+
+// Compares this run's results with the baseline file given to --compare.
+// A kernel regresses when its bandwidth dropped by more than the tolerance and the drop is
+// significant (Welch's t-test on the per-run bandwidths, p < 0.05). Returns true on regression.
+bool compare_with_baseline()
+{
+  std::vector<KernelRecord> baseline;
+  try {
+    baseline = read_json(compare_path);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return true;
+  }
+
+  auto fmt_percent = [](double v) {
+    std::ostringstream pct;
+    pct << std::fixed << std::setprecision(2) << v << "%";
+    return pct.str();
+  };
+  auto fmt_p = [](double p) {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(4) << p;
+    return s.str();
+  };
+
+  std::map<std::string, KernelRecord const*> by_key;
+  for (auto const& b : baseline) by_key[b.key()] = &b;
+
+  // Keep csv output on stdout parseable
+  std::ostream& os = output_as_csv ? std::cerr : std::cout;
+  std::streamsize ss = os.precision();
+  os << std::endl << "Comparison with " << compare_path
+            << " (tolerance " << std::setprecision(1) << std::fixed << tolerance << "%)" << std::endl
+            << std::left << std::setw(16) << "Function"
+            << std::left << std::setw(10) << "Group"
+            << std::left << std::setw(16) << (std::string("Base ") + unit.str() + "/s")
+            << std::left << std::setw(16) << (std::string("Now ") + unit.str() + "/s")
+            << std::left << std::setw(10) << "Delta"
+            << std::left << std::setw(10) << "p-value"
+            << "Status" << std::endl;
+
+  size_t matched = 0, regressions = 0;
+  for (auto const& r : records)
+  {
+    os << std::left << std::setw(16) << r.function << std::left << std::setw(10) << r.group;
+    auto it = by_key.find(r.key());
+    if (it == by_key.end())
+    {
+      os << "no baseline for this kernel and configuration" << std::endl;
+      continue;
+    }
+    ++matched;
+    // The delta and the t-test both use the mean bandwidth; without per-run variance in either
+    // run there is nothing to test, and the tolerance alone decides
+    double before = it->second->mean_bandwidth(), now = r.mean_bandwidth();
+    double delta = 100.0 * (now - before) / before;
+    auto base_bw = it->second->bandwidths(), now_bw = r.bandwidths();
+    bool tested = varies(base_bw) && varies(now_bw);
+    double p = tested ? welch_p_value(base_bw, now_bw) : 0.0;
+    bool significant = !tested || p < 0.05;
+    char const* status = "ok";
+    if (std::fabs(delta) > tolerance)
+      status = !significant ? "within noise" : delta < 0 ? "REGRESSION" : "improved";
+    if (delta < -tolerance && significant) ++regressions;
+    os << std::left << std::setw(16) << std::setprecision(3) << unit.fmt(before)
+              << std::left << std::setw(16) << std::setprecision(3) << unit.fmt(now)
+              << std::left << std::setw(10) << (std::string(delta >= 0 ? "+" : "") + fmt_percent(delta))
+              << std::left << std::setw(10) << (tested ? fmt_p(p) : std::string("-"))
+              << status << std::endl;
+  }
+  os.precision(ss);
+
+  if (matched == 0)
+  {
+    std::cerr << "No kernels in " << compare_path << " match this run's configuration" << std::endl;
+    return true;
+  }
+  if (regressions > 0)
+    std::cerr << regressions << " kernel(s) regressed by more than " << tolerance << "%" << std::endl;
+  return regressions > 0;
 }
 
 void parseArguments(int argc, char *argv[])
@@ -435,8 +919,27 @@ void parseArguments(int argc, char *argv[])
   {
     if (!std::string("--list").compare(argv[i]))
     {
-      listDevices();
-      exit(EXIT_SUCCESS);
+      list_devices_only = true;
+    }
+    else if (!std::string("--model").compare(argv[i]))
+    {
+      if (++i >= argc)
+      {
+        std::cerr << "Expected model name, plugin path or \"all\" after --model" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+#ifdef STREAM_PLUGIN_SUPPORTED
+      try {
+        auto loaded = load_plugins(argv[i]);
+        plugins.insert(plugins.end(), loaded.begin(), loaded.end());
+      } catch (std::exception const& e) {
+        std::cerr << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+#else
+      std::cerr << "--model is not supported on this platform" << std::endl;
+      std::exit(EXIT_FAILURE);
+#endif
     }
     else if (!std::string("--device").compare(argv[i]))
     {
@@ -525,10 +1028,86 @@ void parseArguments(int argc, char *argv[])
         order = BenchOrder::Isolated;
       }
     }
+    else if (!std::string("--batch").compare(argv[i]))
+    {
+      if (++i >= argc || !parseUInt(argv[i], &batch) || batch < 1)
+      {
+        std::cerr << "Invalid batch size." << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    else if (!std::string("--tune").compare(argv[i]))
+    {
+      std::string method = ++i < argc ? argv[i] : "";
+      if (method == "grid")
+        tune_method = babelstream::TuneMethod::Grid;
+      else if (method == "halving")
+        tune_method = babelstream::TuneMethod::Halving;
+      else
+      {
+        std::cerr << "Expected tuning method after --tune. Options: \"grid\", \"halving\"." << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    else if (!std::string("--tune-trials").compare(argv[i]))
+    {
+      if (++i >= argc || !parseUInt(argv[i], &tune_trials) || tune_trials < 1)
+      {
+        std::cerr << "Invalid number of tuning trials." << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
     else if (!std::string("--csv").compare(argv[i]))
     {
       output_as_csv = true;
     }
+    else if (!std::string("--json").compare(argv[i]))
+    {
+      if (++i >= argc)
+      {
+        std::cerr << "Expected file name after --json" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      json_path = argv[i];
+    }
+    else if (!std::string("--compare").compare(argv[i]))
+    {
+      if (++i >= argc)
+      {
+        std::cerr << "Expected baseline file after --compare" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      compare_path = argv[i];
+    }
+    else if (!std::string("--tolerance").compare(argv[i]))
+    {
+      char* next = nullptr;
+      if (++i < argc) tolerance = std::strtod(argv[i], &next);
+      if (i >= argc || next == argv[i] || (*next && std::string(next) != "%") || tolerance < 0)
+      {
+        std::cerr << "Invalid tolerance, expected a percentage such as 5%." << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    else if (!std::string("--complex").compare(argv[i]))
+    {
+      run_complex_layouts = true;
+    }
+    else if (!std::string("--instances").compare(argv[i]))
+    {
+      if (++i >= argc || !parseUInt(argv[i], &num_instances) || num_instances < 1)
+      {
+        std::cerr << "Invalid number of instances." << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+#ifndef MULTI_INSTANCE_SUPPORTED
+      if (num_instances > 1)
+      {
+        std::cerr << "--instances is only supported on Linux" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+#endif
+    }
     else if (!std::string("--mibibytes").compare(argv[i]))
     {
       unit = Unit(Unit::Kind::MibiByte);
@@ -565,6 +1144,7 @@ void parseArguments(int argc, char *argv[])
       std::cout << "Options:" << std::endl;
       std::cout << "  -h  --help               Print the message" << std::endl;
       std::cout << "      --list               List available devices" << std::endl;
+      std::cout << "      --model      NAME    Run the model plugin NAME (e.g. omp), a plugin path, or \"all\"; repeatable" << std::endl;
       std::cout << "      --device     INDEX   Select device at INDEX" << std::endl;
       std::cout << "  -s  --arraysize  SIZE    Use SIZE elements in the array" << std::endl;
       std::cout << "  -n  --numtimes   NUM     Run the test NUM times (NUM >= 2)" << std::endl;
@@ -572,7 +1152,15 @@ void parseArguments(int argc, char *argv[])
       std::cout << "  -o  --only       NAME    Only run one benchmark (see --print-names)" << std::endl;
       std::cout << "      --print-names        Prints all available benchmark names" << std::endl;
       std::cout << "      --order              Benchmark run order: \"Classic\" (default) or \"Isolated\"." << std::endl;
+      std::cout << "      --batch      K       Time K back-to-back kernel submissions per sample, then sync" << std::endl;
+      std::cout << "      --tune       METHOD  Tune the model's parameters first: \"grid\" or \"halving\" search" << std::endl;
+      std::cout << "      --tune-trials NUM    Runs of each kernel per point in a grid search (default 3)" << std::endl;
       std::cout << "      --csv                Output as csv table" << std::endl;
+      std::cout << "      --json       FILE    Also write the results, including every run's timing, to FILE" << std::endl;
+      std::cout << "      --compare    FILE    Compare with results saved by --json; exit with failure on a regression" << std::endl;
+      std::cout << "      --tolerance  PCT     Bandwidth loss tolerated by --compare, e.g. 5% (default)" << std::endl;
+      std::cout << "      --complex            Run complex Triad and Dot in AoS and SoA layouts (CPU models only)" << std::endl;
+      std::cout << "      --instances  NUM     Run NUM instances concurrently, each bound to its own CPUs and NUMA node" << std::endl;
       std::cout << "      --megabytes          Use MB=10^6 for bandwidth calculation (default)" << std::endl;
       std::cout << "      --mibibytes          Use MiB=2^20 for bandwidth calculation (default MB=10^6)" << std::endl;
       std::cout << "      --gibibytes          Use GiB=2^30 for bandwidth calculation (default MB=10^6)" << std::endl;
@@ -6,6 +6,13 @@
 // source code
 
 #include "OCLStream.h"
+#include "CacheFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
 
 // Cache list of devices
 bool cached = false;
@@ -23,66 +30,94 @@ std::string kernels{R"CLC(
     TYPE initA, TYPE initB, TYPE initC)
   {
     const size_t i = get_global_id(0);
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
+    // Arrays the selected benchmarks do not use are passed as NULL
+    if (a) a[i] = initA;
+    if (b) b[i] = initB;
+    if (c) c[i] = initC;
   }
 
+  // Stream kernel variants, selected with -D defines (see OCLKernelConfig):
+  // - VEC: elements per vloadN/vstoreN (1, 2, 4, 8 or 16)
+  // - GRID_STRIDE: each work-item loops over the arrays with a stride of the global size,
+  //   instead of handling a single vector
+  // Elements past the last whole vector are handled one at a time.
+  #ifndef VEC
+  #define VEC 1
+  #endif
+  #if VEC == 1
+  #define LOADV(i, p) (p)[i]
+  #define STOREV(v, i, p) (p)[i] = (v)
+  #else
+  #define CAT(x, y) x##y
+  #define XCAT(x, y) CAT(x, y)
+  #define LOADV(i, p) XCAT(vload, VEC)(i, p)
+  #define STOREV(v, i, p) XCAT(vstore, VEC)(v, i, p)
+  #endif
+
+  #ifdef GRID_STRIDE
+  #define FOR_EACH_VEC(i, n) for (size_t i = get_global_id(0); i < (n) / VEC; i += get_global_size(0))
+  #else
+  #define FOR_EACH_VEC(i, n) for (size_t i = get_global_id(0); i < (n) / VEC; i = (n))
+  #endif
+  #define FOR_EACH_TAIL(i, n) for (size_t i = (n) / VEC * VEC + get_global_id(0); i < (n); i += get_global_size(0))
+
   kernel void copy(
     global const TYPE * restrict a,
-    global TYPE * restrict c)
+    global TYPE * restrict c,
+    long n)
   {
-    const size_t i = get_global_id(0);
-    c[i] = a[i];
+    FOR_EACH_VEC(i, n) STOREV(LOADV(i, a), i, c);
+    FOR_EACH_TAIL(i, n) c[i] = a[i];
   }
 
   kernel void mul(
     global TYPE * restrict b,
-    global const TYPE * restrict c)
+    global const TYPE * restrict c,
+    long n)
   {
-    const size_t i = get_global_id(0);
-    b[i] = scalar * c[i];
+    FOR_EACH_VEC(i, n) STOREV(scalar * LOADV(i, c), i, b);
+    FOR_EACH_TAIL(i, n) b[i] = scalar * c[i];
   }
 
   kernel void add(
     global const TYPE * restrict a,
     global const TYPE * restrict b,
-    global TYPE * restrict c)
+    global TYPE * restrict c,
+    long n)
   {
-    const size_t i = get_global_id(0);
-    c[i] = a[i] + b[i];
+    FOR_EACH_VEC(i, n) STOREV(LOADV(i, a) + LOADV(i, b), i, c);
+    FOR_EACH_TAIL(i, n) c[i] = a[i] + b[i];
   }
 
   kernel void triad(
     global TYPE * restrict a,
     global const TYPE * restrict b,
-    global const TYPE * restrict c)
+    global const TYPE * restrict c,
+    long n)
   {
-    const size_t i = get_global_id(0);
-    a[i] = b[i] + scalar * c[i];
+    FOR_EACH_VEC(i, n) STOREV(LOADV(i, b) + scalar * LOADV(i, c), i, a);
+    FOR_EACH_TAIL(i, n) a[i] = b[i] + scalar * c[i];
   }
+
   kernel void nstream(
     global TYPE * restrict a,
     global const TYPE * restrict b,
-    global const TYPE * restrict c)
+    global const TYPE * restrict c,
+    long n)
   {
-    const size_t i = get_global_id(0);
-    a[i] += b[i] + scalar * c[i];
+    FOR_EACH_VEC(i, n) STOREV(LOADV(i, a) + LOADV(i, b) + scalar * LOADV(i, c), i, a);
+    FOR_EACH_TAIL(i, n) a[i] += b[i] + scalar * c[i];
   }
 
-  kernel void stream_dot(
-    global const TYPE * restrict a,
-    global const TYPE * restrict b,
-    global TYPE * restrict sum,
-    local TYPE * restrict wg_sum,
-    long array_size)
+  // Sum of x over the work-group, valid in work-item 0. With WG_REDUCE (OpenCL C 2.0) this is
+  // the work_group_reduce_add built-in, otherwise a tree reduction in local memory.
+  TYPE wg_reduce(TYPE x, local TYPE * restrict wg_sum)
   {
-    size_t i = get_global_id(0);
+  #ifdef WG_REDUCE
+    return work_group_reduce_add(x);
+  #else
     const size_t local_i = get_local_id(0);
-    wg_sum[local_i] = 0.0;
-    for (; i < array_size; i += get_global_size(0))
-      wg_sum[local_i] += a[i] * b[i];
-
+    wg_sum[local_i] = x;
     for (int offset = get_local_size(0) / 2; offset > 0; offset /= 2)
     {
       barrier(CLK_LOCAL_MEM_FENCE);
@@ -91,14 +126,86 @@ std::string kernels{R"CLC(
         wg_sum[local_i] += wg_sum[local_i+offset];
       }
     }
+    return wg_sum[local_i];
+  #endif
+  }
 
-    if (local_i == 0)
-      sum[get_group_id(0)] = wg_sum[local_i];
+  kernel void stream_dot(
+    global const TYPE * restrict a,
+    global const TYPE * restrict b,
+    global TYPE * restrict sum,
+    local TYPE * restrict wg_sum,
+    long array_size)
+  {
+    TYPE tmp = 0.0;
+    for (size_t i = get_global_id(0); i < array_size; i += get_global_size(0))
+      tmp += a[i] * b[i];
+
+    const TYPE group_sum = wg_reduce(tmp, wg_sum);
+    if (get_local_id(0) == 0)
+      sum[get_group_id(0)] = group_sum;
+  }
+
+  // Second stage of the dot, run as a single work-group: adds the partial sums of stream_dot
+  // and stores the total in sum[0]
+  kernel void stream_dot_finish(
+    global TYPE * restrict sum,
+    local TYPE * restrict wg_sum,
+    long num_groups)
+  {
+    TYPE tmp = 0.0;
+    for (size_t i = get_local_id(0); i < num_groups; i += get_local_size(0))
+      tmp += sum[i];
+
+    const TYPE total = wg_reduce(tmp, wg_sum);
+    if (get_local_id(0) == 0)
+      sum[0] = total;
   }
 
 )CLC"};
 
 
+namespace
+{
+// Unset variables give the fallback; values that are not a whole number are rejected
+size_t env_to_size_t(const char *name, size_t fallback)
+{
+  const char *v = std::getenv(name);
+  if (v == nullptr)
+    return fallback;
+
+  char *end = nullptr;
+  const unsigned long parsed = std::strtoul(v, &end, 10);
+  if (end == v || *end != '\0' || *v == '-')
+    throw std::runtime_error(std::string("Invalid ") + name + ": " + v);
+
+  return static_cast<size_t>(parsed);
+}
+
+size_t round_up(size_t value, size_t multiple)
+{
+  if (multiple == 0)
+    return value;
+  const size_t rem = value % multiple;
+  return rem == 0 ? value : value + (multiple - rem);
+}
+
+std::string describe(OCLKernelConfig const& cfg)
+{
+  std::ostringstream os;
+  os << "vector width " << cfg.vector_width << ", ";
+  if (cfg.wi_per_cu)
+    os << cfg.wi_per_cu << " work-items per compute unit (grid-stride), ";
+  else
+    os << "one work-item per vector, ";
+  if (cfg.local_size)
+    os << "local size " << cfg.local_size;
+  else
+    os << "runtime local size";
+  return os.str();
+}
+}
+
 template <class T>
 OCLStream<T>::OCLStream(BenchId bs, const intptr_t array_size, const int device_index,
 	       T initA, T initB, T initC)
@@ -113,14 +220,15 @@ OCLStream<T>::OCLStream(BenchId bs, const intptr_t array_size, const int device_
   device = devices[device_index];
 
   // Determine sensible dot kernel NDRange configuration
+  compute_units = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
   if (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU)
   {
-    dot_num_groups = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    dot_num_groups = compute_units;
     dot_wgsize     = device.getInfo<CL_DEVICE_NATIVE_VECTOR_WIDTH_DOUBLE>() * 2;
   }
   else
   {
-    dot_num_groups = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * 4;
+    dot_num_groups = compute_units * 4;
     dot_wgsize     = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
   }
 
@@ -129,127 +237,269 @@ OCLStream<T>::OCLStream(BenchId bs, const intptr_t array_size, const int device_
   std::cout << "Driver: " << getDeviceDriver(device_index) << std::endl;
   std::cout << "Reduction kernel config: " << dot_num_groups << " groups of size " << dot_wgsize << std::endl;
 
+  // BABELSTREAM_OCL_DOT=device finishes the dot with a second kernel, so a single value is read
+  // back instead of every group's partial sum. Work-group built-ins need OpenCL C 2.0.
+  const char *dot_env = std::getenv("BABELSTREAM_OCL_DOT");
+  if (dot_env && std::string(dot_env) == "device")
+  {
+    dot_on_device = true;
+    dot_wg_reduce = device.getInfo<CL_DEVICE_OPENCL_C_VERSION>().compare(0, 11, "OpenCL C 2.") == 0;
+  }
+  else if (dot_env && std::string(dot_env) != "host")
+    throw std::runtime_error("BABELSTREAM_OCL_DOT must be host or device");
+  std::cerr << "Reduction finished on: "
+    << (dot_on_device ? (dot_wg_reduce ? "device (work_group_reduce_add)" : "device") : "host") << std::endl;
+
   context = cl::Context(device);
   queue = cl::CommandQueue(context);
 
-  // Create program
-  cl::Program program(context, kernels);
-  std::ostringstream args;
-  args << "-DstartScalar=" << startScalar << " ";
-  if (sizeof(T) == sizeof(double))
-  {
-    args << "-DTYPE=double";
-    // Check device can do double
-    if (!device.getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>())
-      throw std::runtime_error("Device does not support double precision, please use --float");
-    try
-    {
-      program.build(args.str().c_str());
-    }
-    catch (cl::Error& err)
-    {
-      if (err.err() == CL_BUILD_PROGRAM_FAILURE)
-      {
-        std::cout << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>()[0].second << std::endl;
-        throw err;
-      }
-    }
-  }
-  else if (sizeof(T) == sizeof(float))
+  // Check device can do double
+  if (sizeof(T) == sizeof(double) && !device.getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>())
+    throw std::runtime_error("Device does not support double precision, please use --float");
+
+  // Stream kernel variant, overridable from the environment
+  config.vector_width = env_to_size_t("BABELSTREAM_OCL_VECTOR", config.vector_width);
+  config.wi_per_cu = env_to_size_t("BABELSTREAM_OCL_WI_PER_CU", config.wi_per_cu);
+  config.local_size = env_to_size_t("BABELSTREAM_OCL_LOCAL_SIZE", config.local_size);
+  switch (config.vector_width)
   {
-    args << "-DTYPE=float";
-    program.build(args.str().c_str());
+    case 1: case 2: case 4: case 8: case 16: break;
+    default: throw std::runtime_error("BABELSTREAM_OCL_VECTOR must be 1, 2, 4, 8 or 16");
   }
-
-  // Create kernels
-  init_kernel = new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, T, T, T>(program, "init");
-  copy_kernel = new cl::KernelFunctor<cl::Buffer, cl::Buffer>(program, "copy");
-  mul_kernel = new cl::KernelFunctor<cl::Buffer, cl::Buffer>(program, "mul");
-  add_kernel = new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer>(program, "add");
-  triad_kernel = new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer>(program, "triad");
-  nstream_kernel = new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer>(program, "nstream");
-  dot_kernel = new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl_long>(program, "stream_dot");
+  auto t1 = std::chrono::high_resolution_clock::now();
+  build_kernels(config);
+  auto t2 = std::chrono::high_resolution_clock::now();
+  std::cerr << "Program build: " << std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count()
+    << " s (binary cache " << binary_cache << ")" << std::endl;
 
   // Check buffers fit on the device
   cl_ulong totalmem = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
   cl_ulong maxbuffer = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
   if (maxbuffer < sizeof(T)*array_size)
     throw std::runtime_error("Device cannot allocate a buffer big enough");
-  if (totalmem < 3*sizeof(T)*array_size)
-    throw std::runtime_error("Device does not have enough memory for all 3 buffers");
-
-  // Create buffers
-  d_a = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * array_size);
-  d_b = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * array_size);
-  d_c = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * array_size);
-  d_sum = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(T) * dot_num_groups);
+  int nbuffers = needs_buffer(bs, 'a') + needs_buffer(bs, 'b') + needs_buffer(bs, 'c');
+  if (totalmem < nbuffers*sizeof(T)*array_size)
+    throw std::runtime_error("Device does not have enough memory for all " + std::to_string(nbuffers) + " buffers");
+
+  // Create buffers, only for the arrays the selected benchmarks use
+  if (needs_buffer(bs, 'a'))
+    d_a = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * array_size);
+  if (needs_buffer(bs, 'b'))
+    d_b = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * array_size);
+  if (needs_buffer(bs, 'c'))
+    d_c = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * array_size);
+  d_sum = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * dot_num_groups);
 
   sums = std::vector<T>(dot_num_groups);
 
+  std::cerr << "Stream kernel config: " << describe(config) << std::endl;
+
   init_arrays(initA, initB, initC);
 }
 
 template <class T>
 OCLStream<T>::~OCLStream()
 {
-  delete init_kernel;
-  delete copy_kernel;
-  delete mul_kernel;
-  delete add_kernel;
-  delete triad_kernel;
-  delete nstream_kernel;
-  delete dot_kernel;
-
   devices.clear();
 }
 
+template <class T>
+cl::Program OCLStream<T>::build_program(std::string const& options)
+{
+  // A binary is only valid for the device and driver that produced it, built from the same source
+  // with the same options; the key is stored in the file and checked on load
+  const std::string dir = cache_file::directory("BABELSTREAM_OCL_CACHE", "BABELSTREAM_OCL_CACHE_DIR");
+  const std::string key = device.getInfo<CL_DEVICE_NAME>() + "\n" + device.getInfo<CL_DRIVER_VERSION>() + "\n"
+    + options + "\n" + cache_file::hash_hex(kernels);
+  const std::string path = dir + "/babelstream-ocl-" + cache_file::hash_hex(key) + ".bin";
+
+  if (!dir.empty())
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::string contents{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    if (contents.size() > key.size() && contents.compare(0, key.size() + 1, key + '\0') == 0)
+    {
+      cl::Program::Binaries binaries{
+        std::vector<unsigned char>(contents.begin() + key.size() + 1, contents.end())};
+      try
+      {
+        cl::Program program(context, {device}, binaries);
+        program.build(options.c_str());
+        binary_cache = "hit";
+        return program;
+      }
+      catch (cl::Error&)
+      {
+        // Stale or rejected by the driver: rebuild from source and overwrite it below
+      }
+    }
+  }
+
+  cl::Program program(context, kernels);
+  try
+  {
+    program.build(options.c_str());
+  }
+  catch (cl::Error& err)
+  {
+    if (err.err() == CL_BUILD_PROGRAM_FAILURE)
+      std::cout << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>()[0].second << std::endl;
+    throw;
+  }
+  binary_cache = dir.empty() ? "disabled" : "miss";
+
+  if (!dir.empty())
+  {
+    std::vector<unsigned char> binary = program.getInfo<CL_PROGRAM_BINARIES>()[0];
+    cache_file::write(path, key + '\0' + std::string(binary.begin(), binary.end()));
+  }
+  return program;
+}
+
+template <class T>
+void OCLStream<T>::build_kernels(OCLKernelConfig const& cfg)
+{
+  std::ostringstream args;
+  args << "-DstartScalar=" << startScalar << " ";
+  args << (sizeof(T) == sizeof(double) ? "-DTYPE=double" : "-DTYPE=float");
+  args << " -DVEC=" << cfg.vector_width;
+  if (cfg.wi_per_cu)
+    args << " -DGRID_STRIDE";
+  if (dot_wg_reduce)
+    args << " -DWG_REDUCE -cl-std=CL2.0";
+  cl::Program program = build_program(args.str());
+
+  // Create kernels
+  init_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, T, T, T>(program, "init"));
+  copy_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl_long>(program, "copy"));
+  mul_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl_long>(program, "mul"));
+  add_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl_long>(program, "add"));
+  triad_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl_long>(program, "triad"));
+  nstream_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl_long>(program, "nstream"));
+  dot_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl_long>(program, "stream_dot"));
+  dot_finish_kernel.reset(new cl::KernelFunctor<cl::Buffer, cl::LocalSpaceArg, cl_long>(program, "stream_dot_finish"));
+
+  set_stream_range(cfg);
+}
+
+template <class T>
+void OCLStream<T>::set_stream_range(OCLKernelConfig const& cfg)
+{
+  config = cfg;
+  config.local_size = std::min(config.local_size, device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+
+  // A grid of work-items striding over the arrays, or one per whole vector. Work-items past the
+  // end do nothing, so the global size can be rounded up to a multiple of the local size.
+  size_t global = config.wi_per_cu
+    ? compute_units * config.wi_per_cu
+    : std::max<size_t>(array_size / config.vector_width, 1);
+  stream_global = cl::NDRange(round_up(global, config.local_size));
+  stream_local = config.local_size ? cl::NDRange(config.local_size) : cl::NullRange;
+}
+
+template <class T>
+std::vector<TuneParam> OCLStream<T>::tune_space()
+{
+  TuneParam local{"local_size", {0}};
+  for (long wg : {64, 128, 256})
+    if ((size_t)wg <= device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>())
+      local.values.push_back(wg);
+  return {{"vector_width", {1, 2, 4, 8}}, {"wi_per_cu", {0, 64, 256, 1024}}, local};
+}
+
+template <class T>
+void OCLStream<T>::set_tune_param(std::string const& name, long value)
+{
+  OCLKernelConfig cfg = config;
+  if (name == "vector_width" && cfg.vector_width != (size_t)value)
+  {
+    cfg.vector_width = value;
+    build_kernels(cfg);
+  }
+  else if (name == "wi_per_cu" && cfg.wi_per_cu != (size_t)value)
+  {
+    // Only turning the grid-stride loop on or off changes the program; other values only
+    // change the global size
+    bool rebuild = !cfg.wi_per_cu != !value;
+    cfg.wi_per_cu = value;
+    if (rebuild) build_kernels(cfg);
+    else set_stream_range(cfg);
+  }
+  else if (name == "local_size")
+  {
+    cfg.local_size = value;
+    set_stream_range(cfg);
+  }
+}
+
+template <class T>
+void OCLStream<T>::submit_copy()
+{
+  (*copy_kernel)(stream_range(), d_a, d_c, array_size);
+}
+
 template <class T>
 void OCLStream<T>::copy()
 {
-  (*copy_kernel)(
-    cl::EnqueueArgs(queue, cl::NDRange(array_size)),
-    d_a, d_c
-  );
+  submit_copy();
   queue.finish();
 }
 
+template <class T>
+void OCLStream<T>::submit_mul()
+{
+  (*mul_kernel)(stream_range(), d_b, d_c, array_size);
+}
+
 template <class T>
 void OCLStream<T>::mul()
 {
-  (*mul_kernel)(
-    cl::EnqueueArgs(queue, cl::NDRange(array_size)),
-    d_b, d_c
-  );
+  submit_mul();
   queue.finish();
 }
 
+template <class T>
+void OCLStream<T>::submit_add()
+{
+  (*add_kernel)(stream_range(), d_a, d_b, d_c, array_size);
+}
+
 template <class T>
 void OCLStream<T>::add()
 {
-  (*add_kernel)(
-    cl::EnqueueArgs(queue, cl::NDRange(array_size)),
-    d_a, d_b, d_c
-  );
+  submit_add();
   queue.finish();
 }
 
+template <class T>
+void OCLStream<T>::submit_triad()
+{
+  (*triad_kernel)(stream_range(), d_a, d_b, d_c, array_size);
+}
+
 template <class T>
 void OCLStream<T>::triad()
 {
-  (*triad_kernel)(
-    cl::EnqueueArgs(queue, cl::NDRange(array_size)),
-    d_a, d_b, d_c
-  );
+  submit_triad();
   queue.finish();
 }
 
+template <class T>
+void OCLStream<T>::submit_nstream()
+{
+  (*nstream_kernel)(stream_range(), d_a, d_b, d_c, array_size);
+}
+
 template <class T>
 void OCLStream<T>::nstream()
 {
-  (*nstream_kernel)(
-    cl::EnqueueArgs(queue, cl::NDRange(array_size)),
-    d_a, d_b, d_c
-  );
+  submit_nstream();
+  queue.finish();
+}
+
+template <class T>
+void OCLStream<T>::sync()
+{
   queue.finish();
 }
 
@@ -260,6 +510,18 @@ T OCLStream<T>::dot()
     cl::EnqueueArgs(queue, cl::NDRange(dot_num_groups*dot_wgsize), cl::NDRange(dot_wgsize)),
     d_a, d_b, d_sum, cl::Local(sizeof(T) * dot_wgsize), array_size
   );
+
+  if (dot_on_device)
+  {
+    (*dot_finish_kernel)(
+      cl::EnqueueArgs(queue, cl::NDRange(dot_wgsize), cl::NDRange(dot_wgsize)),
+      d_sum, cl::Local(sizeof(T) * dot_wgsize), (cl_long)dot_num_groups
+    );
+    T sum;
+    queue.enqueueReadBuffer(d_sum, CL_TRUE, 0, sizeof(T), &sum);
+    return sum;
+  }
+
   cl::copy(queue, d_sum, sums.begin(), sums.end());
 
   T sum{};
@@ -282,15 +544,16 @@ void OCLStream<T>::init_arrays(T initA, T initB, T initC)
 template <class T>
 void OCLStream<T>::get_arrays(T const*& a, T const*& b, T const*& c)
 {
-  h_a.resize(array_size);
-  h_b.resize(array_size);
-  h_c.resize(array_size);
-  a = h_a.data();
-  b = h_b.data();
-  c = h_c.data();
-  cl::copy(queue, d_a, h_a.begin(), h_a.end());
-  cl::copy(queue, d_b, h_b.begin(), h_b.end());
-  cl::copy(queue, d_c, h_c.begin(), h_c.end());
+  // Only read back the buffers that exist
+  auto read = [&](cl::Buffer& d, std::vector<T>& h) -> T const* {
+    if (!d()) return nullptr;
+    h.resize(array_size);
+    cl::copy(queue, d, h.begin(), h.end());
+    return h.data();
+  };
+  a = read(d_a, h_a);
+  b = read(d_b, h_b);
+  c = read(d_c, h_c);
 }
 
 void getDeviceList(void)
@@ -8,8 +8,10 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 
 #define CL_HPP_ENABLE_EXCEPTIONS
 #define CL_HPP_TARGET_OPENCL_VERSION 120
@@ -21,6 +23,18 @@
 
 #define IMPLEMENTATION_STRING "OpenCL"
 
+// Variant of the stream kernels (Copy, Mul, Add, Triad, Nstream). The vector width and loop
+// shape are compiled in with -D defines, so changing them rebuilds the program.
+struct OCLKernelConfig
+{
+  // Elements per vloadN/vstoreN; 1 for scalar loads
+  size_t vector_width = 1;
+  // Work-items per compute unit running a grid-stride loop; 0 launches one work-item per vector
+  size_t wi_per_cu = 0;
+  // Explicit work-group size; 0 lets the runtime choose
+  size_t local_size = 0;
+};
+
 template <class T>
 class OCLStream : public Stream<T>
 {
@@ -45,17 +59,38 @@ class OCLStream : public Stream<T>
     // Host-side arrays for verification
     std::vector<T> h_a, h_b, h_c;
 
-    cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, T, T, T> *init_kernel;
-    cl::KernelFunctor<cl::Buffer, cl::Buffer> *copy_kernel;
-    cl::KernelFunctor<cl::Buffer, cl::Buffer> * mul_kernel;
-    cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer> *add_kernel;
-    cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer> *triad_kernel;
-    cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer> *nstream_kernel;
-    cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl_long> *dot_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, T, T, T>> init_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::Buffer, cl_long>> copy_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::Buffer, cl_long>> mul_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl_long>> add_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl_long>> triad_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl_long>> nstream_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl_long>> dot_kernel;
+    std::unique_ptr<cl::KernelFunctor<cl::Buffer, cl::LocalSpaceArg, cl_long>> dot_finish_kernel;
+
+    // Stream kernel variant and its NDRange
+    OCLKernelConfig config;
+    size_t compute_units;
+    cl::NDRange stream_global, stream_local;
 
     // NDRange configuration for the dot kernel
     size_t dot_num_groups;
     size_t dot_wgsize;
+    // Add the partial sums with a second kernel rather than on the host, with the
+    // work_group_reduce_add built-in when the device supports OpenCL C 2.0
+    bool dot_on_device = false;
+    bool dot_wg_reduce = false;
+
+    // Result of the last program build's binary cache lookup: hit, miss or disabled
+    std::string binary_cache;
+
+    // Builds the kernel source with `options`, or loads the binary cached by an earlier run
+    cl::Program build_program(std::string const& options);
+    // Builds the program for `cfg` and creates every kernel from it
+    void build_kernels(OCLKernelConfig const& cfg);
+    // Makes `cfg` current and derives the stream NDRange from it
+    void set_stream_range(OCLKernelConfig const& cfg);
+    cl::EnqueueArgs stream_range() { return cl::EnqueueArgs(queue, stream_global, stream_local); }
 
   public:
 
@@ -70,8 +105,20 @@ class OCLStream : public Stream<T>
     void nstream() override;
     T dot() override;
 
+    // Enqueue on the in-order queue without waiting
+    void submit_copy() override;
+    void submit_add() override;
+    void submit_mul() override;
+    void submit_triad() override;
+    void submit_nstream() override;
+    void sync() override;
+
     void get_arrays(T const*& a, T const*& b, T const*& c) override;
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
+
+    // The OCLKernelConfig fields; vector_width, and wi_per_cu to or from 0, rebuild the program
+    std::vector<TuneParam> tune_space() override;
+    void set_tune_param(std::string const& name, long value) override;
 };
 
 // Populate the devices list
@@ -5,7 +5,14 @@
 // For full license terms please see the LICENSE file distributed with this
 // source code
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cstdlib>  // For aligned_alloc
+#include <sstream>
+#include <string>
+#include <type_traits>
 #include "OMPStream.h"
 
 #if defined(PAGEFAULT)
@@ -16,15 +23,152 @@
 #define ALIGNMENT (2*1024*1024) // 2MB
 #endif
 
+#ifndef OMP_TARGET_GPU
+namespace
+{
+  // omp_sched_monotonic, or 0 when omp.h does not have it. It is detected from omp_sched_t
+  // itself because libgomp has it while still reporting _OPENMP 201511.
+  template <class Sched, class = void>
+  struct sched_monotonic : std::integral_constant<unsigned, 0> {};
+  template <class Sched>
+  struct sched_monotonic<Sched, decltype(void(Sched::omp_sched_monotonic))>
+    : std::integral_constant<unsigned, unsigned(Sched::omp_sched_monotonic)> {};
+  constexpr unsigned monotonic_flag = sched_monotonic<omp_sched_t>::value;
+
+  // A positive integer with nothing after it
+  bool parse_positive(char const* str, long& value)
+  {
+    char* end;
+    errno = 0;
+    value = std::strtol(str, &end, 10);
+    return !errno && std::isdigit((unsigned char)*str) && !*end && value > 0;
+  }
+
+  // Parses an OMP_SCHEDULE style string: [monotonic:|nonmonotonic:]kind[,chunk]
+  bool parse_schedule(std::string s, omp_sched_t& kind, int& chunk)
+  {
+    bool monotonic = false, nonmonotonic = false;
+    if (s.rfind("monotonic:", 0) == 0) { monotonic = true; s = s.substr(10); }
+    else if (s.rfind("nonmonotonic:", 0) == 0) { nonmonotonic = true; s = s.substr(13); }
+    chunk = 0;
+    auto comma = s.find(',');
+    if (comma != std::string::npos) {
+      long value;
+      if (!parse_positive(s.c_str() + comma + 1, value) || value > INT_MAX) return false;
+      chunk = int(value);
+      s = s.substr(0, comma);
+    }
+    if (s == "static") kind = omp_sched_static;
+    else if (s == "dynamic") kind = omp_sched_dynamic;
+    else if (s == "guided") kind = omp_sched_guided;
+    else if (s == "auto") kind = omp_sched_auto;
+    else return false;
+    if (nonmonotonic && kind == omp_sched_static) return false;
+    // The modifiers cannot be honoured without omp_sched_monotonic
+    if (!monotonic_flag) return !monotonic && !nonmonotonic;
+    // Since OpenMP 5.0 dynamic and guided default to nonmonotonic; plain "dynamic" keeps its
+    // OpenMP 4.5 (monotonic) meaning so the two can be compared
+    if (monotonic || (!nonmonotonic && kind != omp_sched_static && kind != omp_sched_auto))
+      kind = omp_sched_t(kind | monotonic_flag);
+    return true;
+  }
+
+  std::string schedule_string()
+  {
+    omp_sched_t kind;
+    int chunk;
+    omp_get_schedule(&kind, &chunk);
+    std::ostringstream os;
+    bool monotonic = kind & monotonic_flag;
+    kind = omp_sched_t(kind & ~monotonic_flag);
+    if (monotonic_flag && (kind == omp_sched_dynamic || kind == omp_sched_guided))
+      os << (monotonic ? "monotonic:" : "nonmonotonic:");
+    switch (kind) {
+    case omp_sched_static:  os << "static"; break;
+    case omp_sched_dynamic: os << "dynamic"; break;
+    case omp_sched_guided:  os << "guided"; break;
+    case omp_sched_auto:    os << "auto"; break;
+    default:                os << "unknown"; break;
+    }
+    if (chunk > 0) os << "," << chunk;
+    return os.str();
+  }
+
+  char const* proc_bind_string(omp_proc_bind_t bind)
+  {
+    switch ((int)bind) {
+    case 0: return "false";
+    case 1: return "true";
+    case 2: return "primary";
+    case 3: return "close";
+    case 4: return "spread";
+    default: return "unknown";
+    }
+  }
+
+  // CPU each OpenMP thread is running on, indexed by thread number
+  std::vector<int> thread_cpus()
+  {
+    std::vector<int> cpus(omp_get_max_threads(), -1);
+    #pragma omp parallel
+    cpus[omp_get_thread_num()] = ThreadProfile::current_cpu();
+    return cpus;
+  }
+}
+#endif
+
 template <class T>
 OMPStream<T>::OMPStream(BenchId bs, const intptr_t array_size, const int device,
 			T initA, T initB, T initC)
   : array_size(array_size)
 {
-  // Allocate on the host
-  this->a = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
-  this->b = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
-  this->c = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+#ifndef OMP_TARGET_GPU
+  // Host kernels use schedule(runtime): BABELSTREAM_OMP_SCHEDULE takes precedence over the
+  // standard OMP_SCHEDULE, and without either we pin static to match a bare `parallel for`
+  char const* env = std::getenv("BABELSTREAM_OMP_SCHEDULE");
+  if (env && *env) {
+    omp_sched_t kind;
+    int chunk;
+    if (!parse_schedule(env, kind, chunk))
+      throw std::runtime_error(std::string("Invalid BABELSTREAM_OMP_SCHEDULE: ") + env);
+    omp_set_schedule(kind, chunk);
+  } else if (!std::getenv("OMP_SCHEDULE")) {
+    omp_set_schedule(omp_sched_static, 0);
+  }
+  char const* mode_env = std::getenv("BABELSTREAM_OMP_MODE");
+  std::string mode_name = mode_env && *mode_env ? mode_env : "fork";
+  if (mode_name == "fork") mode = OMPMode::Fork;
+  else if (mode_name == "persistent") mode = OMPMode::Persistent;
+  else if (mode_name == "taskloop") mode = OMPMode::Taskloop;
+  else throw std::runtime_error("Invalid BABELSTREAM_OMP_MODE: " + mode_name);
+  // Default to eight tasks per thread, enough for the runtime to balance them
+  grainsize = std::max<intptr_t>(array_size / (8 * (intptr_t)omp_get_max_threads()), 1);
+  char const* grain_env = std::getenv("BABELSTREAM_OMP_GRAINSIZE");
+  if (grain_env && *grain_env) {
+    long value;
+    if (!parse_positive(grain_env, value))
+      throw std::runtime_error(std::string("Invalid BABELSTREAM_OMP_GRAINSIZE: ") + grain_env);
+    grainsize = value;
+  }
+
+  std::cerr << "OpenMP schedule: " << schedule_string()
+            << ", proc_bind: " << proc_bind_string(omp_get_proc_bind())
+            << ", threads: " << omp_get_max_threads()
+            << ", mode: " << mode_name;
+  if (mode == OMPMode::Taskloop) std::cerr << " (grainsize " << grainsize << ")";
+  std::cerr << std::endl;
+  if (mode != OMPMode::Fork && profile.enabled())
+    std::cerr << "BABELSTREAM_THREAD_PROFILE only applies to the fork mode" << std::endl;
+
+  char const* affinity = std::getenv("BABELSTREAM_OMP_AFFINITY");
+  verify_affinity = affinity && std::string(affinity) != "0";
+  if (verify_affinity) start_cpus = thread_cpus();
+#endif
+
+  // Allocate on the host, only the arrays the selected benchmarks use
+  this->a = needs_buffer(bs, 'a') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+  this->b = needs_buffer(bs, 'b') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+  this->c = needs_buffer(bs, 'c') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
 
 #ifdef OMP_TARGET_GPU
   omp_set_default_device(device);
@@ -32,8 +176,9 @@ OMPStream<T>::OMPStream(BenchId bs, const intptr_t array_size, const int device,
     T *a = this->a;
     T *b = this->b;
     T *c = this->c;
-    // Set up data region on device
-    #pragma omp target enter data map(alloc: a[0:array_size], b[0:array_size], c[0:array_size])
+    // Set up data region on device; unused arrays map as empty sections
+    intptr_t na = a ? array_size : 0, nb = b ? array_size : 0, nc = c ? array_size : 0;
+    #pragma omp target enter data map(alloc: a[0:na], b[0:nb], c[0:nc])
     {}
   #endif
 #endif
@@ -50,8 +195,21 @@ OMPStream<T>::~OMPStream()
   T *a = this->a;
   T *b = this->b;
   T *c = this->c;
-  #pragma omp target exit data map(release: a[0:array_size], b[0:array_size], c[0:array_size])
+  intptr_t na = a ? array_size : 0, nb = b ? array_size : 0, nc = c ? array_size : 0;
+  #pragma omp target exit data map(release: a[0:na], b[0:nb], c[0:nc])
   {}
+#else
+  profile.report(std::cerr, IMPLEMENTATION_STRING);
+  if (verify_affinity) {
+    // Threads that moved between construction and the end of the run were not pinned
+    auto end_cpus = thread_cpus();
+    std::cerr << "OpenMP thread placement (thread: cpu at start -> cpu at end):" << std::endl;
+    for (size_t t = 0; t < end_cpus.size(); ++t) {
+      int start = t < start_cpus.size() ? start_cpus[t] : -1;
+      std::cerr << "  " << t << ": " << start << " -> " << end_cpus[t]
+                << (start != end_cpus[t] ? " (migrated)" : "") << std::endl;
+    }
+  }
 #endif
   free(a);
   free(b);
@@ -68,13 +226,13 @@ void OMPStream<T>::init_arrays(T initA, T initB, T initC)
   T *c = this->c;
   #pragma omp target teams distribute parallel for simd
 #else
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(runtime)
 #endif
   for (intptr_t i = 0; i < array_size; i++)
   {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
+    if (a) a[i] = initA;
+    if (b) b[i] = initB;
+    if (c) c[i] = initC;
   }
   #if defined(OMP_TARGET_GPU) && defined(_CRAYC) && !defined(PAGEFAULT)
   // If using the Cray compiler, the kernels do not block, so this update forces
@@ -91,7 +249,8 @@ void OMPStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
   T *a = this->a;
   T *b = this->b;
   T *c = this->c;
-  #pragma omp target update from(a[0:array_size], b[0:array_size], c[0:array_size])
+  intptr_t na = a ? array_size : 0, nb = b ? array_size : 0, nc = c ? array_size : 0;
+  #pragma omp target update from(a[0:na], b[0:nb], c[0:nc])
   {}
 #endif
   h_a = a;
@@ -99,16 +258,213 @@ void OMPStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
   h_c = c;
 }
 
+#ifndef OMP_TARGET_GPU
+template <class T>
+template <typename F>
+T OMPStream<T>::profiled(char const* kernel, F body)
+{
+  // Hand out blocks of the schedule's chunk size (or one block per thread for an unchunked
+  // schedule) one at a time, which distributes them like the schedule itself would
+  omp_sched_t kind;
+  int chunk;
+  omp_get_schedule(&kind, &chunk);
+  intptr_t nthreads = omp_get_max_threads();
+  intptr_t block = chunk > 0 ? chunk : (array_size + nthreads - 1) / nthreads;
+  intptr_t nblocks = (array_size + block - 1) / block;
+  omp_set_schedule(kind, 1);
+
+  T sum{};
+  profile.begin(nthreads);
+  #pragma omp parallel reduction(+:sum)
+  {
+    intptr_t t = omp_get_thread_num();
+    #pragma omp for schedule(runtime) nowait
+    for (intptr_t k = 0; k < nblocks; k++)
+    {
+      intptr_t begin = k * block;
+      intptr_t end = std::min(array_size, begin + block);
+      double t0 = ThreadProfile::now();
+      sum += body(begin, end);
+      profile.record(t, t0, ThreadProfile::now(), end - begin);
+    }
+  }
+  omp_set_schedule(kind, chunk);
+  profile.end(kernel);
+  return sum;
+}
+
+template <class T>
+void OMPStream<T>::run_region(std::function<void()> const& loop)
+{
+  switch (mode) {
+  // Every thread runs the driver's loop; kernels share out their iterations with orphaned
+  // worksharing, so threads are forked once rather than once per kernel
+  case OMPMode::Persistent:
+    #pragma omp parallel
+    loop();
+    break;
+  // One thread runs the loop and spawns tasks, the rest of the team executes them
+  case OMPMode::Taskloop:
+    #pragma omp parallel
+    #pragma omp single
+    loop();
+    break;
+  default:
+    loop();
+  }
+}
+
+template <class T>
+bool OMPStream<T>::leader() const
+{
+  return mode != OMPMode::Persistent || omp_get_thread_num() == 0;
+}
+
+template <class T>
+std::vector<TuneParam> OMPStream<T>::tune_space()
+{
+  if (mode == OMPMode::Taskloop)
+  {
+    // From one task per thread to 32
+    TuneParam grain{"grainsize", {}};
+    intptr_t nthreads = omp_get_max_threads();
+    for (intptr_t tasks : {1, 2, 4, 8, 16, 32})
+      grain.values.push_back(std::max<intptr_t>(array_size / (nthreads * tasks), 1));
+    return {grain};
+  }
+  // 0 is the schedule's default chunk
+  return {{"chunk", {0, 1024, 4096, 16384, 65536}}};
+}
+
+template <class T>
+void OMPStream<T>::set_tune_param(std::string const& name, long value)
+{
+  if (name == "grainsize")
+    grainsize = std::max<intptr_t>(value, 1);
+  else if (name == "chunk")
+  {
+    omp_sched_t kind;
+    int chunk;
+    omp_get_schedule(&kind, &chunk);
+    omp_set_schedule(kind, (int)value);
+  }
+}
+
+// Outside run_region (e.g. called from init or by a library user), both modes open their own
+// parallel region for the call.
+template <class T>
+template <typename F>
+void OMPStream<T>::host_for(F body)
+{
+  intptr_t array_size = this->array_size;
+  if (mode == OMPMode::Persistent)
+  {
+    if (omp_get_level() > 0)
+    {
+      // The leader starts its timer before the first barrier and stops it after the second,
+      // so the timed region covers every thread's share
+      #pragma omp barrier
+      #pragma omp for schedule(runtime) nowait
+      for (intptr_t i = 0; i < array_size; i++)
+        body(i);
+      #pragma omp barrier
+    }
+    else
+    {
+      #pragma omp parallel for schedule(runtime)
+      for (intptr_t i = 0; i < array_size; i++)
+        body(i);
+    }
+    return;
+  }
+
+  // A taskloop ends with an implicit taskgroup, so the kernel is complete on return
+  if (omp_get_level() > 0)
+  {
+    #pragma omp taskloop grainsize(grainsize)
+    for (intptr_t i = 0; i < array_size; i++)
+      body(i);
+  }
+  else
+  {
+    #pragma omp parallel
+    #pragma omp single
+    #pragma omp taskloop grainsize(grainsize)
+    for (intptr_t i = 0; i < array_size; i++)
+      body(i);
+  }
+}
+
+template <class T>
+template <typename F>
+T OMPStream<T>::host_reduce(F body)
+{
+  intptr_t array_size = this->array_size;
+  T sum{};
+  if (mode == OMPMode::Persistent)
+  {
+    if (omp_get_level() > 0)
+    {
+      // The single's barrier starts the kernel and the reduction's barrier ends it; the last
+      // barrier keeps the next reduction from resetting region_sum before everyone has read it
+      #pragma omp single
+      region_sum = T{};
+      #pragma omp for schedule(runtime) reduction(+:region_sum)
+      for (intptr_t i = 0; i < array_size; i++)
+        region_sum += body(i);
+      sum = region_sum;
+      #pragma omp barrier
+    }
+    else
+    {
+      #pragma omp parallel for schedule(runtime) reduction(+:sum)
+      for (intptr_t i = 0; i < array_size; i++)
+        sum += body(i);
+    }
+    return sum;
+  }
+
+  if (omp_get_level() > 0)
+  {
+    #pragma omp taskloop grainsize(grainsize) reduction(+:sum)
+    for (intptr_t i = 0; i < array_size; i++)
+      sum += body(i);
+  }
+  else
+  {
+    #pragma omp parallel
+    #pragma omp single
+    #pragma omp taskloop grainsize(grainsize) reduction(+:sum)
+    for (intptr_t i = 0; i < array_size; i++)
+      sum += body(i);
+  }
+  return sum;
+}
+#endif
+
 template <class T>
 void OMPStream<T>::copy()
 {
+#ifndef OMP_TARGET_GPU
+  if (mode != OMPMode::Fork)
+    return host_for([&](intptr_t i) { c[i] = a[i]; });
+  if (profile.enabled())
+  {
+    profiled("Copy", [&](intptr_t begin, intptr_t end) {
+      for (intptr_t i = begin; i < end; i++)
+        c[i] = a[i];
+      return T{};
+    });
+    return;
+  }
+#endif
 #if defined(OMP_TARGET_GPU) && !defined(PAGEFAULT)
   intptr_t array_size = this->array_size;
   T *a = this->a;
   T *c = this->c;
   #pragma omp target teams distribute parallel for simd
 #else
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(runtime)
 #endif
   for (intptr_t i = 0; i < array_size; i++)
   {
@@ -126,6 +482,20 @@ void OMPStream<T>::mul()
 {
   const T scalar = startScalar;
 
+#ifndef OMP_TARGET_GPU
+  if (mode != OMPMode::Fork)
+    return host_for([&](intptr_t i) { b[i] = scalar * c[i]; });
+  if (profile.enabled())
+  {
+    profiled("Mul", [&](intptr_t begin, intptr_t end) {
+      for (intptr_t i = begin; i < end; i++)
+        b[i] = scalar * c[i];
+      return T{};
+    });
+    return;
+  }
+#endif
+
 #ifdef OMP_TARGET_GPU
   #if !defined(PAGEFAULT)
     intptr_t array_size = this->array_size;
@@ -134,7 +504,7 @@ void OMPStream<T>::mul()
   #endif
   #pragma omp target teams distribute parallel for simd
 #else
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(runtime)
 #endif
   for (intptr_t i = 0; i < array_size; i++)
   {
@@ -150,6 +520,19 @@ void OMPStream<T>::mul()
 template <class T>
 void OMPStream<T>::add()
 {
+#ifndef OMP_TARGET_GPU
+  if (mode != OMPMode::Fork)
+    return host_for([&](intptr_t i) { c[i] = a[i] + b[i]; });
+  if (profile.enabled())
+  {
+    profiled("Add", [&](intptr_t begin, intptr_t end) {
+      for (intptr_t i = begin; i < end; i++)
+        c[i] = a[i] + b[i];
+      return T{};
+    });
+    return;
+  }
+#endif
 #ifdef OMP_TARGET_GPU
   #if !defined(PAGEFAULT)
     intptr_t array_size = this->array_size;
@@ -159,7 +542,7 @@ void OMPStream<T>::add()
   #endif
   #pragma omp target teams distribute parallel for simd
 #else
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(runtime)
 #endif
   for (intptr_t i = 0; i < array_size; i++)
   {
@@ -177,6 +560,20 @@ void OMPStream<T>::triad()
 {
   const T scalar = startScalar;
 
+#ifndef OMP_TARGET_GPU
+  if (mode != OMPMode::Fork)
+    return host_for([&](intptr_t i) { a[i] = b[i] + scalar * c[i]; });
+  if (profile.enabled())
+  {
+    profiled("Triad", [&](intptr_t begin, intptr_t end) {
+      for (intptr_t i = begin; i < end; i++)
+        a[i] = b[i] + scalar * c[i];
+      return T{};
+    });
+    return;
+  }
+#endif
+
 #ifdef OMP_TARGET_GPU
   #if !defined(PAGEFAULT)
     intptr_t array_size = this->array_size;
@@ -186,7 +583,7 @@ void OMPStream<T>::triad()
   #endif
   #pragma omp target teams distribute parallel for simd
 #else
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(runtime)
 #endif
   for (intptr_t i = 0; i < array_size; i++)
   {
@@ -204,6 +601,20 @@ void OMPStream<T>::nstream()
 {
   const T scalar = startScalar;
 
+#ifndef OMP_TARGET_GPU
+  if (mode != OMPMode::Fork)
+    return host_for([&](intptr_t i) { a[i] += b[i] + scalar * c[i]; });
+  if (profile.enabled())
+  {
+    profiled("Nstream", [&](intptr_t begin, intptr_t end) {
+      for (intptr_t i = begin; i < end; i++)
+        a[i] += b[i] + scalar * c[i];
+      return T{};
+    });
+    return;
+  }
+#endif
+
 #ifdef OMP_TARGET_GPU
   #if !defined(PAGEFAULT)
     intptr_t array_size = this->array_size;
@@ -213,7 +624,7 @@ void OMPStream<T>::nstream()
   #endif
   #pragma omp target teams distribute parallel for simd
 #else
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(runtime)
 #endif
   for (intptr_t i = 0; i < array_size; i++)
   {
@@ -229,6 +640,20 @@ void OMPStream<T>::nstream()
 template <class T>
 T OMPStream<T>::dot()
 {
+#ifndef OMP_TARGET_GPU
+  if (mode != OMPMode::Fork)
+    return host_reduce([&](intptr_t i) { return a[i] * b[i]; });
+  if (profile.enabled())
+  {
+    return profiled("Dot", [&](intptr_t begin, intptr_t end) {
+      T sum{};
+      for (intptr_t i = begin; i < end; i++)
+        sum += a[i] * b[i];
+      return sum;
+    });
+  }
+#endif
+
   T sum{};
 
 #ifdef OMP_TARGET_GPU
@@ -239,7 +664,7 @@ T OMPStream<T>::dot()
   #endif
   #pragma omp target teams distribute parallel for simd map(tofrom: sum) reduction(+:sum)
 #else
-  #pragma omp parallel for reduction(+:sum)
+  #pragma omp parallel for schedule(runtime) reduction(+:sum)
 #endif
   for (intptr_t i = 0; i < array_size; i++)
   {
@@ -251,6 +676,148 @@ T OMPStream<T>::dot()
 
 
 
+#ifndef OMP_TARGET_GPU
+
+template <class T>
+OMPComplexStream<T>::OMPComplexStream(const intptr_t array_size, const int,
+                                      std::complex<T> initA, std::complex<T> initB, std::complex<T> initC)
+  : array_size(array_size)
+{
+  // Allocate on the host
+  this->a = (std::complex<T>*)aligned_alloc(ALIGNMENT, sizeof(std::complex<T>)*array_size);
+  this->b = (std::complex<T>*)aligned_alloc(ALIGNMENT, sizeof(std::complex<T>)*array_size);
+  this->c = (std::complex<T>*)aligned_alloc(ALIGNMENT, sizeof(std::complex<T>)*array_size);
+  this->a_re = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->a_im = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->b_re = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->b_im = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->c_re = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->c_im = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+
+  init_arrays(initA, initB, initC);
+}
+
+template <class T>
+OMPComplexStream<T>::~OMPComplexStream()
+{
+  free(a);
+  free(b);
+  free(c);
+  free(a_re);
+  free(a_im);
+  free(b_re);
+  free(b_im);
+  free(c_re);
+  free(c_im);
+}
+
+template <class T>
+void OMPComplexStream<T>::init_arrays(std::complex<T> initA, std::complex<T> initB, std::complex<T> initC)
+{
+  #pragma omp parallel for
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    a[i] = initA;
+    b[i] = initB;
+    c[i] = initC;
+    a_re[i] = initA.real();
+    a_im[i] = initA.imag();
+    b_re[i] = initB.real();
+    b_im[i] = initB.imag();
+    c_re[i] = initC.real();
+    c_im[i] = initC.imag();
+  }
+}
+
+template <class T>
+void OMPComplexStream<T>::get_arrays_aos(std::complex<T> const*& h_a, std::complex<T> const*& h_b,
+                                         std::complex<T> const*& h_c)
+{
+  h_a = a;
+  h_b = b;
+  h_c = c;
+}
+
+template <class T>
+void OMPComplexStream<T>::get_arrays_soa(T const*& h_a_re, T const*& h_a_im, T const*& h_b_re, T const*& h_b_im,
+                                         T const*& h_c_re, T const*& h_c_im)
+{
+  h_a_re = a_re;
+  h_a_im = a_im;
+  h_b_re = b_re;
+  h_b_im = b_im;
+  h_c_re = c_re;
+  h_c_im = c_im;
+}
+
+template <class T>
+void OMPComplexStream<T>::triad_aos()
+{
+  const T s_re = complexScalar<T>().real();
+  const T s_im = complexScalar<T>().imag();
+
+  #pragma omp parallel for
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    const T cr = c[i].real();
+    const T ci = c[i].imag();
+    a[i] = std::complex<T>(b[i].real() + s_re * cr - s_im * ci,
+                           b[i].imag() + s_re * ci + s_im * cr);
+  }
+}
+
+template <class T>
+void OMPComplexStream<T>::triad_soa()
+{
+  const T s_re = complexScalar<T>().real();
+  const T s_im = complexScalar<T>().imag();
+
+  #pragma omp parallel for
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    a_re[i] = b_re[i] + s_re * c_re[i] - s_im * c_im[i];
+    a_im[i] = b_im[i] + s_re * c_im[i] + s_im * c_re[i];
+  }
+}
+
+template <class T>
+std::complex<T> OMPComplexStream<T>::dot_aos()
+{
+  T sum_re{};
+  T sum_im{};
+
+  #pragma omp parallel for reduction(+:sum_re, sum_im)
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    sum_re += a[i].real() * b[i].real() - a[i].imag() * b[i].imag();
+    sum_im += a[i].real() * b[i].imag() + a[i].imag() * b[i].real();
+  }
+
+  return std::complex<T>(sum_re, sum_im);
+}
+
+template <class T>
+std::complex<T> OMPComplexStream<T>::dot_soa()
+{
+  T sum_re{};
+  T sum_im{};
+
+  #pragma omp parallel for reduction(+:sum_re, sum_im)
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    sum_re += a_re[i] * b_re[i] - a_im[i] * b_im[i];
+    sum_im += a_re[i] * b_im[i] + a_im[i] * b_re[i];
+  }
+
+  return std::complex<T>(sum_re, sum_im);
+}
+
+template class OMPComplexStream<float>;
+template class OMPComplexStream<double>;
+
+#endif
+
+
 void listDevices(void)
 {
 #ifdef OMP_TARGET_GPU
@@ -9,13 +9,27 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include "Stream.h"
 
 #include <omp.h>
 
+#ifndef OMP_TARGET_GPU
+#include "ThreadProfile.h"
+#endif
+
 #define IMPLEMENTATION_STRING "OpenMP"
 
+#ifndef OMP_TARGET_GPU
+// How the host kernels are parallelised, selected with BABELSTREAM_OMP_MODE
+enum class OMPMode {
+  Fork,       // a `parallel for` per kernel invocation (default)
+  Persistent, // one parallel region for the whole run; `omp for nowait` and barriers per kernel
+  Taskloop    // one parallel region; a single thread spawns each kernel as a `taskloop`
+};
+#endif
+
 template <class T>
 class OMPStream : public Stream<T>
 {
@@ -28,6 +42,31 @@ class OMPStream : public Stream<T>
     T *b;
     T *c;
 
+#ifndef OMP_TARGET_GPU
+    // Per-thread timings, when enabled with BABELSTREAM_THREAD_PROFILE=1
+    ThreadProfile profile;
+
+    // Record the CPU of each thread at start and end, with BABELSTREAM_OMP_AFFINITY=1
+    bool verify_affinity = false;
+    std::vector<int> start_cpus;
+
+    // Runs body(begin, end) on each thread's static block of the arrays, recording its timing
+    template <typename F>
+    T profiled(char const* kernel, F body);
+
+    OMPMode mode = OMPMode::Fork;
+    // Elements per task in taskloop mode, from BABELSTREAM_OMP_GRAINSIZE
+    intptr_t grainsize = 1;
+    // Reduction target of orphaned `omp for` in persistent mode; must be shared by the team
+    T region_sum;
+
+    // Runs body(i) for every element in the Persistent or Taskloop mode
+    template <typename F>
+    void host_for(F body);
+    template <typename F>
+    T host_reduce(F body);
+#endif
+
   public:
     OMPStream(BenchId bs, const intptr_t array_size, const int device_id,
 	       T initA, T initB, T initC);
@@ -41,5 +80,52 @@ class OMPStream : public Stream<T>
     T dot() override;
 
     void get_arrays(T const*& a, T const*& b, T const*& c) override;
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
+
+#ifndef OMP_TARGET_GPU
+    void run_region(std::function<void()> const& loop) override;
+    bool leader() const override;
+
+    // The schedule's chunk size, or the taskloop grain size in Taskloop mode
+    std::vector<TuneParam> tune_space() override;
+    void set_tune_param(std::string const& name, long value) override;
+#endif
+};
+
+#ifndef OMP_TARGET_GPU
+
+#include "ComplexStream.h"
+
+template <class T>
+class OMPComplexStream : public ComplexStream<T>
+{
+  protected:
+    // Size of arrays
+    intptr_t array_size;
+
+    // AoS: interleaved real/imaginary parts
+    std::complex<T> *a, *b, *c;
+
+    // SoA: separate real and imaginary arrays
+    T *a_re, *a_im;
+    T *b_re, *b_im;
+    T *c_re, *c_im;
+
+  public:
+    OMPComplexStream(const intptr_t array_size, const int device_id,
+                     std::complex<T> initA, std::complex<T> initB, std::complex<T> initC);
+    ~OMPComplexStream();
+
+    void triad_aos() override;
+    void triad_soa() override;
+    std::complex<T> dot_aos() override;
+    std::complex<T> dot_soa() override;
+
+    void get_arrays_aos(std::complex<T> const*& a, std::complex<T> const*& b,
+                        std::complex<T> const*& c) override;
+    void get_arrays_soa(T const*& a_re, T const*& a_im, T const*& b_re, T const*& b_im,
+                        T const*& c_re, T const*& c_im) override;
+    void init_arrays(std::complex<T> initA, std::complex<T> initB, std::complex<T> initC);
 };
+
+#endif
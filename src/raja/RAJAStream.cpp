@@ -5,6 +5,7 @@
 // For full license terms please see the LICENSE file distributed with this
 // source code
 
+#include <algorithm>
 #include <cstdlib>  // For aligned_alloc
 #include <stdexcept>
 #include "RAJAStream.hpp"
@@ -15,20 +16,118 @@ using RAJA::forall;
 #define ALIGNMENT (2*1024*1024) // 2MB
 #endif
 
+// forall with RAJA::expt::Reduce parameters
+#if defined(RAJA_VERSION_MAJOR) && RAJA_VERSION_MAJOR >= 2023
+#define HAS_EXPT_REDUCE
+#endif
+
+#ifdef RAJA_TARGET_CPU
+namespace
+{
+  // Chunk sizes omp_parallel_for_static_exec is instantiated with; 0 is RAJA's default
+  const std::vector<long> static_chunks = {0, 1024, 4096, 16384, 65536};
+
+  char const* env_string(char const* name)
+  {
+    char const* env = std::getenv(name);
+    return env && *env ? env : nullptr;
+  }
+
+  long env_long(char const* name, long fallback)
+  {
+    char const* env = env_string(name);
+    if (!env) return fallback;
+    char* end = nullptr;
+    long value = std::strtol(env, &end, 10);
+    if (*end != '\0' || value < 0)
+      throw std::runtime_error(std::string("Invalid ") + name + ": " + env);
+    return value;
+  }
+
+  std::string policy_name(RAJAOptions const& options)
+  {
+    switch (options.policy)
+    {
+    case RAJAOptions::Policy::Simd: return "simd_exec";
+    case RAJAOptions::Policy::OmpFor: return "omp_parallel_for_exec";
+    case RAJAOptions::Policy::OmpForStatic:
+      return "omp_parallel_for_static_exec<" + (options.chunk ? std::to_string(options.chunk) : std::string()) + ">";
+    case RAJAOptions::Policy::OmpCollapse:
+      return "omp_parallel_collapse_exec, rows of " + std::to_string(options.collapse_inner);
+    default: return "seq_exec";
+    }
+  }
+}
+#endif
+
 template <class T>
 RAJAStream<T>::RAJAStream(BenchId bs, const intptr_t array_size, const int device_index,
 			  T initA, T initB, T initC)
   : array_size(array_size), range(0, array_size)
 {
+#ifdef RAJA_TARGET_CPU
+#ifdef RAJA_ENABLE_OPENMP
+  options.policy = RAJAOptions::Policy::OmpFor;
+#endif
+  if (char const* env = env_string("BABELSTREAM_RAJA_POLICY"))
+  {
+    std::string policy(env);
+    if (policy == "seq") options.policy = RAJAOptions::Policy::Seq;
+    else if (policy == "simd") options.policy = RAJAOptions::Policy::Simd;
+#ifdef RAJA_ENABLE_OPENMP
+    else if (policy == "omp_for") options.policy = RAJAOptions::Policy::OmpFor;
+    else if (policy == "omp_for_static") options.policy = RAJAOptions::Policy::OmpForStatic;
+    else if (policy == "omp_collapse") options.policy = RAJAOptions::Policy::OmpCollapse;
+#endif
+    else throw std::runtime_error("Invalid BABELSTREAM_RAJA_POLICY: " + policy);
+  }
+  options.chunk = env_long("BABELSTREAM_RAJA_CHUNK", options.chunk);
+  if (std::find(static_chunks.begin(), static_chunks.end(), options.chunk) == static_chunks.end())
+    throw std::runtime_error("Invalid BABELSTREAM_RAJA_CHUNK: " + std::to_string(options.chunk) +
+                             " (omp_parallel_for_static_exec is built for 0, 1024, 4096, 16384 and 65536)");
+  // A row longer than the arrays would leave the collapsed loop no rows, so it would run
+  // sequentially; the default is shortened to the array size instead
+  if (env_string("BABELSTREAM_RAJA_COLLAPSE_INNER"))
+  {
+    options.collapse_inner = env_long("BABELSTREAM_RAJA_COLLAPSE_INNER", options.collapse_inner);
+    if (options.collapse_inner < 1 || options.collapse_inner > array_size)
+      throw std::runtime_error("Invalid BABELSTREAM_RAJA_COLLAPSE_INNER: " + std::to_string(options.collapse_inner) +
+                               " (must be between 1 and the array size)");
+  }
+  options.collapse_inner = std::min<long>(options.collapse_inner, array_size);
+  if (char const* env = env_string("BABELSTREAM_RAJA_REDUCER"))
+  {
+    std::string reducer(env);
+    if (reducer == "reducesum") options.reducer = RAJAOptions::Reducer::ReduceSum;
+#ifdef HAS_EXPT_REDUCE
+    else if (reducer == "expt") options.reducer = RAJAOptions::Reducer::Expt;
+#endif
+    else throw std::runtime_error("Invalid BABELSTREAM_RAJA_REDUCER: " + reducer);
+  }
+  if (options.reducer == RAJAOptions::Reducer::Expt && options.policy == RAJAOptions::Policy::OmpCollapse)
+    throw std::runtime_error("BABELSTREAM_RAJA_REDUCER=expt needs a forall policy, not omp_collapse");
+
+  std::cerr << "RAJA policy: " << policy_name(options) << ", Dot reducer: "
+            << (options.reducer == RAJAOptions::Reducer::Expt ? "RAJA::expt::Reduce" : "RAJA::ReduceSum")
+            << std::endl;
+#endif
+
 
+  // Only the arrays the selected benchmarks use are allocated
+  auto alloc = [&](char n) -> T* {
+    T* p = nullptr;
+    if (!needs_buffer(bs, n)) return p;
 #ifdef RAJA_TARGET_CPU
-  d_a = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
-  d_b = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
-  d_c = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+    p = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
 #else
-  cudaMallocManaged((void**)&d_a, sizeof(T)*array_size, cudaMemAttachGlobal);
-  cudaMallocManaged((void**)&d_b, sizeof(T)*array_size, cudaMemAttachGlobal);
-  cudaMallocManaged((void**)&d_c, sizeof(T)*array_size, cudaMemAttachGlobal);
+    cudaMallocManaged((void**)&p, sizeof(T)*array_size, cudaMemAttachGlobal);
+#endif
+    return p;
+  };
+  d_a = alloc('a');
+  d_b = alloc('b');
+  d_c = alloc('c');
+#ifndef RAJA_TARGET_CPU
   cudaDeviceSynchronize();
 #endif
 
@@ -49,17 +148,118 @@ RAJAStream<T>::~RAJAStream()
 #endif
 }
 
+#ifdef RAJA_TARGET_CPU
+template <class T>
+template <class F>
+void RAJAStream<T>::with_policy(F f)
+{
+  switch (options.policy)
+  {
+  case RAJAOptions::Policy::Simd:
+    f(RAJA::simd_exec{}, RAJA::seq_reduce{});
+    break;
+#ifdef RAJA_ENABLE_OPENMP
+  case RAJAOptions::Policy::OmpFor:
+    f(RAJA::omp_parallel_for_exec{}, RAJA::omp_reduce{});
+    break;
+  case RAJAOptions::Policy::OmpForStatic:
+    switch (options.chunk)
+    {
+    case 1024: f(RAJA::omp_parallel_for_static_exec<1024>{}, RAJA::omp_reduce{}); break;
+    case 4096: f(RAJA::omp_parallel_for_static_exec<4096>{}, RAJA::omp_reduce{}); break;
+    case 16384: f(RAJA::omp_parallel_for_static_exec<16384>{}, RAJA::omp_reduce{}); break;
+    case 65536: f(RAJA::omp_parallel_for_static_exec<65536>{}, RAJA::omp_reduce{}); break;
+    default: f(RAJA::omp_parallel_for_static_exec<>{}, RAJA::omp_reduce{});
+    }
+    break;
+  case RAJAOptions::Policy::OmpCollapse:
+    f(collapse_exec{}, RAJA::omp_reduce{});
+    break;
+#endif
+  default:
+    f(RAJA::seq_exec{}, RAJA::seq_reduce{});
+  }
+}
+
+template <class T>
+template <class Exec, class F>
+void RAJAStream<T>::forall_with(Exec, F const& body)
+{
+  forall<Exec>(range, body);
+}
+
+template <class T>
+template <class F>
+void RAJAStream<T>::forall_with(collapse_exec, F const& body)
+{
+#ifdef RAJA_ENABLE_OPENMP
+  // omp_parallel_collapse_exec only applies to nested loops, so the arrays are walked as
+  // rows of collapse_inner elements and the last partial row is finished sequentially
+  using collapse_policy = RAJA::KernelPolicy<
+    RAJA::statement::Collapse<RAJA::omp_parallel_collapse_exec, RAJA::ArgList<0, 1>,
+                              RAJA::statement::Lambda<0>>>;
+  const RAJA::Index_type inner = options.collapse_inner;
+  const RAJA::Index_type rows = array_size / inner;
+  RAJA::kernel<collapse_policy>(RAJA::make_tuple(RangeSegment(0, rows), RangeSegment(0, inner)),
+    [=](RAJA::Index_type row, RAJA::Index_type col)
+  {
+    body(row * inner + col);
+  });
+  forall<RAJA::seq_exec>(RangeSegment(rows * inner, array_size), body);
+#endif
+}
+
+template <class T>
+template <class Exec>
+T RAJAStream<T>::dot_expt(Exec)
+{
+#ifdef HAS_EXPT_REDUCE
+  T* RAJA_RESTRICT a = d_a;
+  T* RAJA_RESTRICT b = d_b;
+  T sum{};
+  forall<Exec>(range, RAJA::expt::Reduce<RAJA::operators::plus>(&sum),
+    [=](RAJA::Index_type index, T& s)
+  {
+    s += a[index] * b[index];
+  });
+  return sum;
+#else
+  throw std::runtime_error("RAJA::expt::Reduce requires RAJA v2023 or newer");
+#endif
+}
+
+template <class T>
+T RAJAStream<T>::dot_expt(collapse_exec)
+{
+  throw std::runtime_error("RAJA::expt::Reduce needs a forall policy, not omp_collapse");
+}
+#endif
+
+template <class T>
+template <class F>
+void RAJAStream<T>::for_each(F const& body)
+{
+#ifdef RAJA_TARGET_CPU
+  with_policy([&](auto exec, auto)
+  {
+    this->forall_with(exec, body);
+  });
+#else
+  forall<policy>(range, body);
+#endif
+}
+
 template <class T>
 void RAJAStream<T>::init_arrays(T initA, T initB, T initC)
 {
   T* RAJA_RESTRICT a = d_a;
   T* RAJA_RESTRICT b = d_b;
   T* RAJA_RESTRICT c = d_c;
-  forall<policy>(range, [=] RAJA_DEVICE (RAJA::Index_type index)
+  for_each([=] RAJA_DEVICE (RAJA::Index_type index)
   {
-    a[index] = initA;
-    b[index] = initB;
-    c[index] = initC;
+    if (a) a[index] = initA;
+    if (b) b[index] = initB;
+    if (c) c[index] = initC;
   });
 }
 
@@ -76,7 +276,7 @@ void RAJAStream<T>::copy()
 {
   T* RAJA_RESTRICT a = d_a;
   T* RAJA_RESTRICT c = d_c;
-  forall<policy>(range, [=] RAJA_DEVICE (RAJA::Index_type index)
+  for_each([=] RAJA_DEVICE (RAJA::Index_type index)
   {
     c[index] = a[index];
   });
@@ -88,7 +288,7 @@ void RAJAStream<T>::mul()
   T* RAJA_RESTRICT b = d_b;
   T* RAJA_RESTRICT c = d_c;
   const T scalar = startScalar;
-  forall<policy>(range, [=] RAJA_DEVICE (RAJA::Index_type index)
+  for_each([=] RAJA_DEVICE (RAJA::Index_type index)
   {
     b[index] = scalar*c[index];
   });
@@ -100,7 +300,7 @@ void RAJAStream<T>::add()
   T* RAJA_RESTRICT a = d_a;
   T* RAJA_RESTRICT b = d_b;
   T* RAJA_RESTRICT c = d_c;
-  forall<policy>(range, [=] RAJA_DEVICE (RAJA::Index_type index)
+  for_each([=] RAJA_DEVICE (RAJA::Index_type index)
   {
     c[index] = a[index] + b[index];
   });
@@ -113,7 +313,7 @@ void RAJAStream<T>::triad()
   T* RAJA_RESTRICT b = d_b;
   T* RAJA_RESTRICT c = d_c;
   const T scalar = startScalar;
-  forall<policy>(range, [=] RAJA_DEVICE (RAJA::Index_type index)
+  for_each([=] RAJA_DEVICE (RAJA::Index_type index)
   {
     a[index] = b[index] + scalar*c[index];
   });
@@ -126,7 +326,7 @@ void RAJAStream<T>::nstream()
   T* RAJA_RESTRICT b = d_b;
   T* RAJA_RESTRICT c = d_c;
   const T scalar = startScalar;
-  forall<policy>(range, [=] RAJA_DEVICE (RAJA::Index_type index)
+  for_each([=] RAJA_DEVICE (RAJA::Index_type index)
   {
     a[index] += b[index] + scalar * c[index];;
   });
@@ -138,6 +338,24 @@ T RAJAStream<T>::dot()
   T* RAJA_RESTRICT a = d_a;
   T* RAJA_RESTRICT b = d_b;
 
+#ifdef RAJA_TARGET_CPU
+  T result{};
+  with_policy([&](auto exec, auto reduce)
+  {
+    if (options.reducer == RAJAOptions::Reducer::Expt)
+    {
+      result = this->dot_expt(exec);
+      return;
+    }
+    RAJA::ReduceSum<decltype(reduce), T> sum(T{});
+    this->forall_with(exec, [=](RAJA::Index_type index)
+    {
+      sum += a[index] * b[index];
+    });
+    result = T(sum);
+  });
+  return result;
+#else
   RAJA::ReduceSum<reduce_policy, T> sum(T{});
 
   forall<policy>(range, [=] RAJA_DEVICE (RAJA::Index_type index)
@@ -146,8 +364,42 @@ T RAJAStream<T>::dot()
   });
 
   return T(sum);
+#endif
+}
+
+#ifdef RAJA_TARGET_CPU
+template <class T>
+std::vector<TuneParam> RAJAStream<T>::tune_space()
+{
+  std::vector<TuneParam> space;
+  if (options.policy == RAJAOptions::Policy::OmpForStatic)
+    space.push_back({"chunk", static_chunks});
+  else if (options.policy == RAJAOptions::Policy::OmpCollapse)
+  {
+    TuneParam inner{"collapse_inner", {}};
+    for (long n : {256, 1024, 4096, 16384})
+      inner.values.push_back(std::min<long>(n, array_size));
+    inner.values.erase(std::unique(inner.values.begin(), inner.values.end()), inner.values.end());
+    space.push_back(inner);
+  }
+#ifdef HAS_EXPT_REDUCE
+  // 0 is RAJA::ReduceSum, 1 is RAJA::expt::Reduce, named as in BABELSTREAM_RAJA_REDUCER
+  if (options.policy != RAJAOptions::Policy::OmpCollapse)
+    space.push_back({"reducer", {0, 1}, {"reducesum", "expt"}});
+#endif
+  return space;
 }
 
+template <class T>
+void RAJAStream<T>::set_tune_param(std::string const& name, long value)
+{
+  if (name == "chunk") options.chunk = value;
+  else if (name == "collapse_inner") options.collapse_inner = std::min<long>(std::max(value, 1L), array_size);
+  else if (name == "reducer")
+    options.reducer = value ? RAJAOptions::Reducer::Expt : RAJAOptions::Reducer::ReduceSum;
+}
+#endif
+
 
 void listDevices(void)
 {
@@ -8,6 +8,8 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 #include "RAJA/RAJA.hpp"
 
 #include "Stream.h"
@@ -15,13 +17,24 @@
 #define IMPLEMENTATION_STRING "RAJA"
 
 #ifdef RAJA_TARGET_CPU
-// TODO verify old and new templates are semantically equal
-//typedef RAJA::ExecPolicy<
-//        RAJA::seq_segit,
-//        RAJA::omp_parallel_for_exec> policy;
+// Execution policies and Dot reducers are chosen at run time on the CPU, from the
+// BABELSTREAM_RAJA_* environment variables (see the README)
+struct RAJAOptions
+{
+  // forall with seq_exec, simd_exec, omp_parallel_for_exec or
+  // omp_parallel_for_static_exec<chunk>, or a RAJA::kernel that views the arrays as rows of
+  // `collapse_inner` elements and runs both loops with omp_parallel_collapse_exec
+  enum class Policy {Seq, Simd, OmpFor, OmpForStatic, OmpCollapse} policy = Policy::Seq;
+  // Chunk size of omp_parallel_for_static_exec; 0 is RAJA's default. The chunk is a template
+  // argument, so only the sizes in RAJAStream.cpp are available.
+  long chunk = 0;
+  long collapse_inner = 1024;
+  // RAJA::ReduceSum objects, or the RAJA::expt::Reduce parameters of forall
+  enum class Reducer {ReduceSum, Expt} reducer = Reducer::ReduceSum;
+};
 
-typedef RAJA::omp_parallel_for_exec policy;
-typedef RAJA::omp_reduce reduce_policy;
+// Stands in for an execution policy when the kernels run as collapsed RAJA::kernel loops
+struct collapse_exec {};
 #else
 const size_t block_size = 128;
 // TODO verify old and new templates are semantically equal
@@ -49,6 +62,25 @@ class RAJAStream : public Stream<T>
     T* d_b;
     T* d_c;
 
+#ifdef RAJA_TARGET_CPU
+    RAJAOptions options;
+
+    // Calls f(exec, reduce) with default constructed instances of the selected execution
+    // policy and its matching reduction policy
+    template <class F>
+    void with_policy(F f);
+    template <class Exec, class F>
+    void forall_with(Exec, F const& body);
+    template <class F>
+    void forall_with(collapse_exec, F const& body);
+    template <class Exec>
+    T dot_expt(Exec);
+    T dot_expt(collapse_exec);
+#endif
+    // Runs body(index) over the whole range with the selected policy
+    template <class F>
+    void for_each(F const& body);
+
   public:
     RAJAStream(BenchId bs, const intptr_t array_size, const int device_id,
 	       T initA, T initB, T initC);
@@ -62,6 +94,12 @@ class RAJAStream : public Stream<T>
     T dot() override;
 
     void get_arrays(T const*& a, T const*& b, T const*& c) override;  
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
+
+#ifdef RAJA_TARGET_CPU
+    // Execution policy and, with omp_parallel_for_static_exec, its chunk size
+    std::vector<TuneParam> tune_space() override;
+    void set_tune_param(std::string const& name, long value) override;
+#endif
 };
 
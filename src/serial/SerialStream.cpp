@@ -17,10 +17,11 @@ SerialStream<T>::SerialStream(BenchId bs, const intptr_t array_size, const int d
 			      T initA, T initB, T initC)
   : array_size{array_size}
 {
-  // Allocate on the host
-  this->a = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
-  this->b = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
-  this->c = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  // Allocate on the host, only the arrays the selected benchmarks use
+  auto alloc = [&](char n) { return needs_buffer(bs, n) ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr; };
+  this->a = alloc('a');
+  this->b = alloc('b');
+  this->c = alloc('c');
 
   init_arrays(initA, initB, initC);
 }
@@ -39,9 +40,9 @@ void SerialStream<T>::init_arrays(T initA, T initB, T initC)
   intptr_t array_size = this->array_size;
   for (intptr_t i = 0; i < array_size; i++)
   {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
+    if (a) a[i] = initA;
+    if (b) b[i] = initB;
+    if (c) c[i] = initC;
   }
 }
 
@@ -113,6 +114,138 @@ T SerialStream<T>::dot()
 }
 
 
+template <class T>
+SerialComplexStream<T>::SerialComplexStream(const intptr_t array_size, const int,
+                                            std::complex<T> initA, std::complex<T> initB, std::complex<T> initC)
+  : array_size{array_size}
+{
+  // Allocate on the host
+  this->a = (std::complex<T>*)aligned_alloc(ALIGNMENT, sizeof(std::complex<T>)*array_size);
+  this->b = (std::complex<T>*)aligned_alloc(ALIGNMENT, sizeof(std::complex<T>)*array_size);
+  this->c = (std::complex<T>*)aligned_alloc(ALIGNMENT, sizeof(std::complex<T>)*array_size);
+  this->a_re = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->a_im = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->b_re = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->b_im = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->c_re = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+  this->c_im = (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size);
+
+  init_arrays(initA, initB, initC);
+}
+
+template <class T>
+SerialComplexStream<T>::~SerialComplexStream()
+{
+  free(a);
+  free(b);
+  free(c);
+  free(a_re);
+  free(a_im);
+  free(b_re);
+  free(b_im);
+  free(c_re);
+  free(c_im);
+}
+
+template <class T>
+void SerialComplexStream<T>::init_arrays(std::complex<T> initA, std::complex<T> initB, std::complex<T> initC)
+{
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    a[i] = initA;
+    b[i] = initB;
+    c[i] = initC;
+    a_re[i] = initA.real();
+    a_im[i] = initA.imag();
+    b_re[i] = initB.real();
+    b_im[i] = initB.imag();
+    c_re[i] = initC.real();
+    c_im[i] = initC.imag();
+  }
+}
+
+template <class T>
+void SerialComplexStream<T>::get_arrays_aos(std::complex<T> const*& h_a, std::complex<T> const*& h_b,
+                                            std::complex<T> const*& h_c)
+{
+  h_a = a;
+  h_b = b;
+  h_c = c;
+}
+
+template <class T>
+void SerialComplexStream<T>::get_arrays_soa(T const*& h_a_re, T const*& h_a_im, T const*& h_b_re, T const*& h_b_im,
+                                            T const*& h_c_re, T const*& h_c_im)
+{
+  h_a_re = a_re;
+  h_a_im = a_im;
+  h_b_re = b_re;
+  h_b_im = b_im;
+  h_c_re = c_re;
+  h_c_im = c_im;
+}
+
+template <class T>
+void SerialComplexStream<T>::triad_aos()
+{
+  const T s_re = complexScalar<T>().real();
+  const T s_im = complexScalar<T>().imag();
+
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    const T cr = c[i].real();
+    const T ci = c[i].imag();
+    a[i] = std::complex<T>(b[i].real() + s_re * cr - s_im * ci,
+                           b[i].imag() + s_re * ci + s_im * cr);
+  }
+}
+
+template <class T>
+void SerialComplexStream<T>::triad_soa()
+{
+  const T s_re = complexScalar<T>().real();
+  const T s_im = complexScalar<T>().imag();
+
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    a_re[i] = b_re[i] + s_re * c_re[i] - s_im * c_im[i];
+    a_im[i] = b_im[i] + s_re * c_im[i] + s_im * c_re[i];
+  }
+}
+
+template <class T>
+std::complex<T> SerialComplexStream<T>::dot_aos()
+{
+  T sum_re{};
+  T sum_im{};
+
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    sum_re += a[i].real() * b[i].real() - a[i].imag() * b[i].imag();
+    sum_im += a[i].real() * b[i].imag() + a[i].imag() * b[i].real();
+  }
+
+  return std::complex<T>(sum_re, sum_im);
+}
+
+template <class T>
+std::complex<T> SerialComplexStream<T>::dot_soa()
+{
+  T sum_re{};
+  T sum_im{};
+
+  for (intptr_t i = 0; i < array_size; i++)
+  {
+    sum_re += a_re[i] * b_re[i] - a_im[i] * b_im[i];
+    sum_im += a_re[i] * b_im[i] + a_im[i] * b_re[i];
+  }
+
+  return std::complex<T>(sum_re, sum_im);
+}
+
+template class SerialComplexStream<float>;
+template class SerialComplexStream<double>;
+
 
 void listDevices(void)
 {
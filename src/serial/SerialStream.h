@@ -38,5 +38,37 @@ class SerialStream : public Stream<T>
     T dot() override;
 
     void get_arrays(T const*& a, T const*& b, T const*& c) override;
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
+};
+
+#include "ComplexStream.h"
+
+template <class T>
+class SerialComplexStream : public ComplexStream<T>
+{
+  protected:
+    // Size of arrays
+    intptr_t array_size;
+
+    // AoS: interleaved real/imaginary parts
+    std::complex<T> *a, *b, *c;
+
+    // SoA: separate real and imaginary arrays
+    T *a_re, *a_im, *b_re, *b_im, *c_re, *c_im;
+
+  public:
+    SerialComplexStream(const intptr_t array_size, const int device_id,
+                        std::complex<T> initA, std::complex<T> initB, std::complex<T> initC);
+    ~SerialComplexStream();
+
+    void triad_aos() override;
+    void triad_soa() override;
+    std::complex<T> dot_aos() override;
+    std::complex<T> dot_soa() override;
+
+    void get_arrays_aos(std::complex<T> const*& a, std::complex<T> const*& b,
+                        std::complex<T> const*& c) override;
+    void get_arrays_soa(T const*& a_re, T const*& a_im, T const*& b_re, T const*& b_im,
+                        T const*& c_re, T const*& c_im) override;
+    void init_arrays(std::complex<T> initA, std::complex<T> initB, std::complex<T> initC);
 };
@@ -10,6 +10,10 @@
 
 #if defined(DATA23) || defined(INDICES)
 #include <ranges>
+#endif
+
+#ifdef DATA17
+#include "zip_iterator.h"
 #endif
 
  // OneDPL workaround; TODO: remove this eventually
@@ -35,29 +39,43 @@ auto counting_range(intptr_t b, intptr_t e) { return std::views::iota(b, e); }
 #endif // NVHPC Workaround
 #endif // INDICES  
 
+namespace
+{
+  std::string policy_from_env()
+  {
+    char const* env = std::getenv("BABELSTREAM_STD_POLICY");
+    return env && *env ? env : "par_unseq";
+  }
+}
+
 template <class T>
 STDStream<T>::STDStream(BenchId bs, const intptr_t array_size, const int device_id,
 			      T initA, T initB, T initC)
-  noexcept : array_size{array_size},
-  a(alloc_raw<T>(array_size)), b(alloc_raw<T>(array_size)), c(alloc_raw<T>(array_size))
+  : array_size{array_size},
+  policy{parse_exe_policy(policy_from_env())},
+  // Only the arrays the selected benchmarks use are allocated
+  a(needs_buffer(bs, 'a') ? alloc_raw<T>(array_size) : nullptr),
+  b(needs_buffer(bs, 'b') ? alloc_raw<T>(array_size) : nullptr),
+  c(needs_buffer(bs, 'c') ? alloc_raw<T>(array_size) : nullptr)
 {
-    std::cout << "Backing storage typeid: " << typeid(a).name() << std::endl;
+    std::cerr << "Backing storage typeid: " << typeid(a).name() << std::endl;
+    std::cerr << "Execution policy: " << exe_policy_name(policy) << std::endl;
 #ifdef USE_ONEDPL
-    std::cout << "Using oneDPL backend: ";
+    std::cerr << "Using oneDPL backend: ";
 #if ONEDPL_USE_DPCPP_BACKEND
-    std::cout << "SYCL USM (device=" << exe_policy.queue().get_device().get_info<sycl::info::device::name>() << ")";
+    std::cerr << "SYCL USM (device=" << exe_policy.queue().get_device().get_info<sycl::info::device::name>() << ")";
 #elif ONEDPL_USE_TBB_BACKEND
-    std::cout << "TBB " TBB_VERSION_STRING;
+    std::cerr << "TBB " TBB_VERSION_STRING;
 #elif ONEDPL_USE_OPENMP_BACKEND
-    std::cout << "OpenMP";
+    std::cerr << "OpenMP";
 #else
-    std::cout << "Default";
+    std::cerr << "Default";
 #endif
-    std::cout << std::endl;
+    std::cerr << std::endl;
 #endif
 
 #ifdef WORKAROUND
-    std::cout << "Non-conforming implementation: requires non-portable workarounds to run STREAM" << std::endl;
+    std::cerr << "Non-conforming implementation: requires non-portable workarounds to run STREAM" << std::endl;
 #endif      
     init_arrays(initA, initB, initC);
 }
@@ -72,9 +90,11 @@ STDStream<T>::~STDStream() {
 template <class T>
 void STDStream<T>::init_arrays(T initA, T initB, T initC)
 {
-  std::fill_n(exe_policy, a, array_size, initA);
-  std::fill_n(exe_policy, b, array_size, initB);
-  std::fill_n(exe_policy, c, array_size, initC);
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    if (a) std::fill_n(exe_policy, a, array_size, initA);
+    if (b) std::fill_n(exe_policy, b, array_size, initB);
+    if (c) std::fill_n(exe_policy, c, array_size, initC);
+  });
 }
 
 template <class T>
@@ -90,10 +110,14 @@ void STDStream<T>::copy()
 {
   // c[i] = a[i]
 #if defined(DATA17) || defined(DATA23)
-  std::copy(exe_policy, a, a + array_size, c);
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::copy(exe_policy, a, a + array_size, c);
+  });
 #elif INDICES
-  std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a,c=c](intptr_t i) {
-      c[i] = a[i];
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a,c=c](intptr_t i) {
+        c[i] = a[i];
+    });
   });
 #else
   #error unimplemented
@@ -105,10 +129,14 @@ void STDStream<T>::mul()
 {
   //  b[i] = scalar * c[i];
 #if defined(DATA17) || defined(DATA23)  
-  std::transform(exe_policy, c, c + array_size, b, [](T ci){ return startScalar*ci; });
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::transform(exe_policy, c, c + array_size, b, [](T ci){ return startScalar*ci; });
+  });
 #elif INDICES
-  std::for_each_n(exe_policy, counting_iter(0), array_size, [b=b, c=c](intptr_t i) {
-    b[i] = startScalar * c[i];
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::for_each_n(exe_policy, counting_iter(0), array_size, [b=b, c=c](intptr_t i) {
+      b[i] = startScalar * c[i];
+    });
   });
 #else
   #error unimplemented
@@ -120,10 +148,14 @@ void STDStream<T>::add()
 {
   //  c[i] = a[i] + b[i];
 #if defined(DATA17) || defined(DATA23)  
-  std::transform(exe_policy, a, a + array_size, b, c, std::plus<T>());
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::transform(exe_policy, a, a + array_size, b, c, std::plus<T>());
+  });
 #elif INDICES
-  std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a, b=b, c=c](intptr_t i) {
-      c[i] = a[i] + b[i];
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a, b=b, c=c](intptr_t i) {
+        c[i] = a[i] + b[i];
+    });
   });
 #else
   #error unimplemented
@@ -135,10 +167,14 @@ void STDStream<T>::triad()
 {
   //  a[i] = b[i] + scalar * c[i];
 #if defined(DATA17) || defined(DATA23)
-  std::transform(exe_policy, b, b + array_size, c, a, [scalar = startScalar](T bi, T ci){ return bi+scalar*ci; });
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::transform(exe_policy, b, b + array_size, c, a, [scalar = startScalar](T bi, T ci){ return bi+scalar*ci; });
+  });
 #elif INDICES
-  std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a, b=b, c=c](intptr_t i) {
-      a[i] = b[i] + startScalar * c[i];
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a, b=b, c=c](intptr_t i) {
+        a[i] = b[i] + startScalar * c[i];
+    });
   });
 #else
   #error unimplemented
@@ -150,24 +186,30 @@ void STDStream<T>::nstream()
 {
   //  a[i] += b[i] + scalar * c[i];
 #if defined(DATA17)
-  //  Need to do in two round-trips with C++17 STL.
-  //  1: a[i] += b[i]
-  //  2: a[i] += scalar * c[i];
-  std::transform(exe_policy, a, a + array_size, b, a, [](T ai, T bi){ return ai + bi; });
-  std::transform(exe_policy, a, a + array_size, c, a, [](T ai, T ci){ return ai + startScalar*ci; });
+  //  std::transform takes at most two inputs, so b and c are read through one zip iterator
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::transform(exe_policy, a, a + array_size, make_zip_iterator<T, T>(0, b, c), a, [](T ai, auto bc) {
+        auto [bi, ci] = bc;
+        return ai + bi + startScalar * ci;
+    });
+  });
 #elif DATA23
   // Requires GCC 14.1 (Ubuntu 24.04):
   auto as = std::ranges::subrange(a, a + array_size);
   auto bs = std::ranges::subrange(b, b + array_size);
   auto cs = std::ranges::subrange(c, c + array_size);
   auto r = std::views::zip(as, bs, cs);
-  std::transform(exe_policy, r.begin(), r.end(), a, [](auto vs) {
-      auto [a, b, c] = vs;
-      return a + b + startScalar * c;
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::transform(exe_policy, r.begin(), r.end(), a, [](auto vs) {
+        auto [a, b, c] = vs;
+        return a + b + startScalar * c;
+    });
   });
 #elif INDICES
-  std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a,b=b,c=c](intptr_t i) {
-    a[i] += b[i] + startScalar * c[i];
+  with_exe_policy(policy, [&](auto const& exe_policy) {
+    std::for_each_n(exe_policy, counting_iter(0), array_size, [a=a,b=b,c=c](intptr_t i) {
+      a[i] += b[i] + startScalar * c[i];
+    });
   });
 #else
   #error unimplemented
@@ -180,11 +222,15 @@ T STDStream<T>::dot()
 {
 #if defined(DATA17) || defined(DATA23)  
   // sum = 0; sum += a[i] * b[i]; return sum;
-  return std::transform_reduce(exe_policy, a, a + array_size, b, T{0});
+  return with_exe_policy(policy, [&](auto const& exe_policy) {
+    return std::transform_reduce(exe_policy, a, a + array_size, b, T{0});
+  });
 #elif INDICES
   auto r = counting_range(intptr_t(0), array_size);
-  return std::transform_reduce(exe_policy, r.begin(), r.end(), T{0}, std::plus<T>{}, [a=a, b=b](intptr_t i) {
-      return a[i] * b[i];
+  return with_exe_policy(policy, [&](auto const& exe_policy) {
+    return std::transform_reduce(exe_policy, r.begin(), r.end(), T{0}, std::plus<T>{}, [a=a, b=b](intptr_t i) {
+        return a[i] * b[i];
+    });
   });
 #else
   #error unimplemented
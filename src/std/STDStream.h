@@ -22,6 +22,9 @@
 
 #define IMPLEMENTATION_STRING "STD (" STDIMPL ")"
 
+// Defined in dpl_shim.h
+enum class exe_policy_kind;
+
 
 template <class T>
 class STDStream : public Stream<T>
@@ -30,12 +33,16 @@ class STDStream : public Stream<T>
     // Size of arrays
     intptr_t array_size;
 
+    // Execution policy of every algorithm, from BABELSTREAM_STD_POLICY (default par_unseq).
+    // Declared before the arrays, so an invalid value is rejected before they are allocated.
+    exe_policy_kind policy;
+
     // Device side pointers
     T *a, *b, *c;
 
   public:
     STDStream(BenchId bs, const intptr_t array_size, const int device_id,
-		  T initA, T initB, T initC) noexcept;
+		  T initA, T initB, T initC);
     ~STDStream();
 
     void copy() override;
@@ -46,6 +53,6 @@ class STDStream : public Stream<T>
     T dot() override;
 
     void get_arrays(T const*& a, T const*& b, T const*& c) override;
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
 };
 
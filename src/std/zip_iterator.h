@@ -0,0 +1,76 @@
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+// A C++17 random access iterator reading several arrays in lockstep, for kernels that have more
+// inputs than std::transform accepts (std::views::zip needs C++23).
+//
+// It is a position plus the base pointers. Dereferencing yields a tuple of const references to
+// element i of each array, so parallel algorithms split it like any random access range.
+//
+// Limitation: `reference` is that tuple, a proxy rather than value_type const&, so this is not a
+// conforming Cpp17 random access (or even forward) iterator. It still claims
+// random_access_iterator_tag because parallel backends (libstdc++'s PSTL, oneDPL) check
+// iterator_category for exactly that tag and would run the algorithm serially for anything
+// weaker. Use it only with algorithms that read elements through *it or it[n] by value, like
+// the std::transform in STDStream; not with ones that take addresses of, or bind value_type& to,
+// the elements.
+
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+template <typename... Ts>
+class zip_iterator
+{
+  std::tuple<Ts const*...> ptrs;
+  std::intptr_t i = 0;
+
+  template <size_t... Is>
+  auto deref(std::intptr_t n, std::index_sequence<Is...>) const {
+    return std::tuple<Ts const&...>(std::get<Is>(ptrs)[n]...);
+  }
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::tuple<Ts...>;
+    using difference_type = std::intptr_t;
+    using reference = std::tuple<Ts const&...>;
+    using pointer = void;
+
+    zip_iterator() = default;
+    zip_iterator(std::intptr_t i, Ts const*... ptrs) : ptrs(ptrs...), i(i) {}
+
+    reference operator*() const { return deref(i, std::index_sequence_for<Ts...>{}); }
+    reference operator[](difference_type n) const { return deref(i + n, std::index_sequence_for<Ts...>{}); }
+
+    zip_iterator& operator++() { ++i; return *this; }
+    zip_iterator& operator--() { --i; return *this; }
+    zip_iterator operator++(int) { zip_iterator t = *this; ++i; return t; }
+    zip_iterator operator--(int) { zip_iterator t = *this; --i; return t; }
+    zip_iterator& operator+=(difference_type n) { i += n; return *this; }
+    zip_iterator& operator-=(difference_type n) { i -= n; return *this; }
+    zip_iterator operator+(difference_type n) const { zip_iterator t = *this; return t += n; }
+    zip_iterator operator-(difference_type n) const { zip_iterator t = *this; return t -= n; }
+    friend zip_iterator operator+(difference_type n, zip_iterator const& it) { return it + n; }
+    difference_type operator-(zip_iterator const& o) const { return i - o.i; }
+
+    bool operator==(zip_iterator const& o) const { return i == o.i; }
+    bool operator!=(zip_iterator const& o) const { return i != o.i; }
+    bool operator<(zip_iterator const& o) const { return i < o.i; }
+    bool operator>(zip_iterator const& o) const { return i > o.i; }
+    bool operator<=(zip_iterator const& o) const { return i <= o.i; }
+    bool operator>=(zip_iterator const& o) const { return i >= o.i; }
+};
+
+// Iterator to element i of the given arrays
+template <typename... Ts>
+zip_iterator<Ts...> make_zip_iterator(std::intptr_t i, Ts const*... ptrs)
+{
+  return zip_iterator<Ts...>(i, ptrs...);
+}
@@ -0,0 +1,237 @@
+
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "StdexecStream.h"
+
+#ifndef ALIGNMENT
+#define ALIGNMENT (2*1024*1024) // 2MB
+#endif
+
+namespace
+{
+  std::uint32_t pool_threads()
+  {
+    char const* env = std::getenv("BABELSTREAM_STDEXEC_THREADS");
+    if (env && *env) {
+      int n = std::atoi(env);
+      if (n <= 0) throw std::runtime_error(std::string("Invalid BABELSTREAM_STDEXEC_THREADS: ") + env);
+      return n;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+template <class T>
+StdexecStream<T>::StdexecStream(BenchId bs, const intptr_t array_size, const int device,
+                                T initA, T initB, T initC)
+  : array_size(array_size), pool(pool_threads())
+{
+  if (device != 0)
+    throw std::runtime_error("Device != 0 is not supported by stdexec");
+
+  nblocks = pool.available_parallelism();
+  partial.resize(nblocks);
+
+  // Only a whole Classic pass, ended by Dot, is pipelined; the driver times it as one sample
+  char const* env = std::getenv("BABELSTREAM_STDEXEC_PIPELINE");
+  pipeline = env && std::string(env) != "0";
+  std::cerr << "stdexec static_thread_pool: " << nblocks << " threads"
+            << (pipeline ? ", Classic passes pipelined up to Dot" : "") << std::endl;
+
+  // Allocate on the host, only the arrays the selected benchmarks use
+  this->a = needs_buffer(bs, 'a') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+  this->b = needs_buffer(bs, 'b') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+  this->c = needs_buffer(bs, 'c') ? (T*)aligned_alloc(ALIGNMENT, sizeof(T)*array_size) : nullptr;
+
+  init_arrays(initA, initB, initC);
+}
+
+template <class T>
+StdexecStream<T>::~StdexecStream()
+{
+  flush();
+  free(a);
+  free(b);
+  free(c);
+}
+
+template <class T>
+kernel_chain StdexecStream<T>::take_pending()
+{
+  if (!pending)
+    return kernel_chain(stdexec::just());
+  kernel_chain chain = std::move(*pending);
+  pending.reset();
+  return chain;
+}
+
+template <class T>
+template <typename F>
+void StdexecStream<T>::launch(F body)
+{
+  std::size_t n = array_size, nb = nblocks;
+  auto blocks = stdexec::bulk(nb, [=](std::size_t k) {
+    body(n * k / nb, n * (k + 1) / nb);
+  });
+  auto sched = pool.get_scheduler();
+  // A type-erased sender has no completion scheduler, so continues_on moves the chain back onto
+  // the pool before bulk, which the pool then runs in parallel
+  if (chaining)
+    pending.emplace(take_pending() | stdexec::continues_on(sched) | std::move(blocks));
+  else
+    stdexec::sync_wait(stdexec::schedule(sched) | std::move(blocks));
+}
+
+template <class T>
+void StdexecStream<T>::flush()
+{
+  if (pending)
+    stdexec::sync_wait(take_pending());
+}
+
+template <class T>
+void StdexecStream<T>::init_arrays(T initA, T initB, T initC)
+{
+  T *a = this->a, *b = this->b, *c = this->c;
+  launch([=](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+    {
+      if (a) a[i] = initA;
+      if (b) b[i] = initB;
+      if (c) c[i] = initC;
+    }
+  });
+  flush();
+}
+
+template <class T>
+void StdexecStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
+{
+  flush();
+  h_a = a;
+  h_b = b;
+  h_c = c;
+}
+
+// Kernels capture by value: in classic() they run after the call has returned
+
+template <class T>
+void StdexecStream<T>::copy()
+{
+  T *a = this->a, *c = this->c;
+  launch([=](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+      c[i] = a[i];
+  });
+}
+
+template <class T>
+void StdexecStream<T>::mul()
+{
+  const T scalar = startScalar;
+  T *b = this->b, *c = this->c;
+  launch([=](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+      b[i] = scalar * c[i];
+  });
+}
+
+template <class T>
+void StdexecStream<T>::add()
+{
+  T *a = this->a, *b = this->b, *c = this->c;
+  launch([=](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+      c[i] = a[i] + b[i];
+  });
+}
+
+template <class T>
+void StdexecStream<T>::triad()
+{
+  const T scalar = startScalar;
+  T *a = this->a, *b = this->b, *c = this->c;
+  launch([=](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+      a[i] = b[i] + scalar * c[i];
+  });
+}
+
+template <class T>
+void StdexecStream<T>::nstream()
+{
+  const T scalar = startScalar;
+  T *a = this->a, *b = this->b, *c = this->c;
+  launch([=](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+      a[i] += b[i] + scalar * c[i];
+  });
+}
+
+template <class T>
+T StdexecStream<T>::dot()
+{
+  // bulk computes one partial sum per block, then sums them in block order
+  T *a = this->a, *b = this->b, *partial = this->partial.data();
+  std::size_t n = array_size, nb = nblocks;
+  auto blocks = stdexec::bulk(nb, [=](std::size_t k) {
+    T sum{};
+    for (std::size_t i = n * k / nb; i < n * (k + 1) / nb; i++)
+      sum += a[i] * b[i];
+    partial[k] = sum;
+  });
+  auto reduce = stdexec::then([=] {
+    T sum{};
+    for (std::size_t k = 0; k < nb; k++)
+      sum += partial[k];
+    return sum;
+  });
+
+  auto sched = pool.get_scheduler();
+  std::optional<std::tuple<T>> result;
+  if (pending)
+    result = stdexec::sync_wait(take_pending() | stdexec::continues_on(sched) | std::move(blocks) | std::move(reduce));
+  else
+    result = stdexec::sync_wait(stdexec::schedule(sched) | std::move(blocks) | std::move(reduce));
+  return std::get<0>(result.value());
+}
+
+template <class T>
+T StdexecStream<T>::classic()
+{
+  chaining = true;
+  copy();
+  mul();
+  add();
+  triad();
+  chaining = false;
+  return dot();
+}
+
+void listDevices(void)
+{
+  std::cout << "0: CPU" << std::endl;
+}
+
+std::string getDeviceName(const int)
+{
+  return std::string("Device name unavailable");
+}
+
+std::string getDeviceDriver(const int)
+{
+  return std::string("Device driver unavailable");
+}
+
+template class StdexecStream<float>;
+template class StdexecStream<double>;
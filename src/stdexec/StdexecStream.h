@@ -0,0 +1,78 @@
+
+// Copyright (c) 2015-16 Tom Deakin, Simon McIntosh-Smith,
+// University of Bristol HPC
+//
+// For full license terms please see the LICENSE file distributed with this
+// source code
+
+#pragma once
+
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+#include <exec/any_sender_of.hpp>
+#include <exec/static_thread_pool.hpp>
+
+#include "Stream.h"
+
+#define IMPLEMENTATION_STRING "stdexec"
+
+// Type-erased sender of a (possibly pipelined) chain of kernels
+using kernel_chain = typename exec::any_receiver_ref<stdexec::completion_signatures<
+    stdexec::set_value_t(), stdexec::set_error_t(std::exception_ptr), stdexec::set_stopped_t()>>
+  ::template any_sender<>;
+
+template <class T>
+class StdexecStream : public Stream<T>
+{
+  protected:
+    // Size of arrays
+    intptr_t array_size;
+
+    // Device side pointers
+    T *a;
+    T *b;
+    T *c;
+
+    exec::static_thread_pool pool;
+    // Each kernel is a bulk over this many contiguous blocks, one per pool thread
+    std::size_t nblocks;
+    // Dot partial sums, one per block
+    std::vector<T> partial;
+
+    // With BABELSTREAM_STDEXEC_PIPELINE=1 the driver runs the Classic kernels through classic(),
+    // which appends Copy, Mul, Add and Triad to `pending` instead of waiting for them; the chain
+    // then runs to completion with Dot
+    bool pipeline = false;
+    bool chaining = false;
+    std::optional<kernel_chain> pending;
+
+    // Returns the pending chain moved onto the pool, or a fresh schedule onto the pool
+    kernel_chain take_pending();
+    // Runs body(begin, end) on every block
+    template <typename F>
+    void launch(F body);
+    void flush();
+
+  public:
+    StdexecStream(BenchId bs, const intptr_t array_size, const int device_id,
+                  T initA, T initB, T initC);
+    ~StdexecStream();
+
+    void copy() override;
+    void add() override;
+    void mul() override;
+    void triad() override;
+    void nstream() override;
+    T dot() override;
+
+    bool fused_classic() const override { return pipeline; }
+    T classic() override;
+
+    void get_arrays(T const*& a, T const*& b, T const*& c) override;
+    void init_arrays(T initA, T initB, T initC) override;
+};
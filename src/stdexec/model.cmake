@@ -0,0 +1,25 @@
+
+register_flag_optional(CMAKE_CXX_COMPILER
+        "Any CXX compiler that is supported by stdexec (GCC 11+, Clang 16+, NVHPC 23.3+).
+         See https://github.com/NVIDIA/stdexec#supported-compilers"
+        "c++")
+
+register_flag_optional(STDEXEC_IN_TREE
+        "Absolute path to the *source* distribution directory of stdexec.
+         If unspecified, an installed stdexec is located with find_package(stdexec), so set
+         CMAKE_PREFIX_PATH or stdexec_DIR if it is not in a default location.
+         The model uses the bulk(shape, f) and continues_on API of stdexec releases from late 2024
+         until the execution-policy bulk overloads (P3481)." "")
+
+macro(setup)
+    set(CMAKE_CXX_STANDARD 20)
+    if (EXISTS "${STDEXEC_IN_TREE}")
+        message(STATUS "Build using in-tree stdexec source at `${STDEXEC_IN_TREE}`")
+        set(STDEXEC_BUILD_EXAMPLES OFF CACHE BOOL "" FORCE)
+        set(STDEXEC_BUILD_TESTS OFF CACHE BOOL "" FORCE)
+        add_subdirectory(${STDEXEC_IN_TREE} ${CMAKE_BINARY_DIR}/stdexec EXCLUDE_FROM_ALL)
+    else ()
+        find_package(stdexec REQUIRED)
+    endif ()
+    register_link_library(STDEXEC::stdexec)
+endmacro()
@@ -6,11 +6,13 @@
 // source code
 
 #include "SYCLStream.h"
+#include "CacheFile.h"
 
 #include <iostream>
 #include <algorithm>
 #include <cstdlib>
 #include <chrono>
+#include <fstream>
 #include <limits>
 
 using namespace sycl;
@@ -65,7 +67,7 @@ std::vector<device> devices;
 void getDeviceList(void);
 
 template <class T>
-SYCLStream<T>::SYCLStream(BenchId, const intptr_t ARRAY_SIZE, const int device_index,
+SYCLStream<T>::SYCLStream(BenchId bs, const intptr_t ARRAY_SIZE, const int device_index,
                           T initA, T initB, T initC)
 {
   if (!cached)
@@ -132,6 +134,7 @@ SYCLStream<T>::SYCLStream(BenchId, const intptr_t ARRAY_SIZE, const int device_i
   const size_t compute_units = std::max<size_t>(1, dev.get_info<info::device::max_compute_units>());
   dot_sum_capacity = std::max<size_t>(dot_num_groups, compute_units * 32);
 
+  // In-order, so kernels submitted back-to-back without waiting (--batch) run in program order
   queue = std::make_unique<sycl::queue>(dev, sycl::async_handler{[&](sycl::exception_list l)
   {
     bool error = false;
@@ -151,11 +154,12 @@ SYCLStream<T>::SYCLStream(BenchId, const intptr_t ARRAY_SIZE, const int device_i
     {
       throw std::runtime_error("SYCL errors detected");
     }
-  }});
+  }}, sycl::property_list{sycl::property::queue::in_order{}});
 
-  d_a = sycl::malloc_device<T>(array_size, *queue);
-  d_b = sycl::malloc_device<T>(array_size, *queue);
-  d_c = sycl::malloc_device<T>(array_size, *queue);
+  // Only the arrays the selected benchmarks use are allocated; the others stay null
+  d_a = needs_buffer(bs, 'a') ? sycl::malloc_device<T>(array_size, *queue) : nullptr;
+  d_b = needs_buffer(bs, 'b') ? sycl::malloc_device<T>(array_size, *queue) : nullptr;
+  d_c = needs_buffer(bs, 'c') ? sycl::malloc_device<T>(array_size, *queue) : nullptr;
   d_sum = sycl::malloc_device<T>(dot_sum_capacity, *queue);
   d_dot = sycl::malloc_device<T>(1, *queue);
   h_sum = new T[dot_sum_capacity];
@@ -178,16 +182,22 @@ SYCLStream<T>::SYCLStream(BenchId, const intptr_t ARRAY_SIZE, const int device_i
   const bool enable_stream_autotune = env_to_bool("BABELSTREAM_SYCL_STREAM_AUTOTUNE", false);
   const bool enable_dot_autotune = env_to_bool("BABELSTREAM_SYCL_DOT_AUTOTUNE", is_intel_gpu && !user_pinned_dot);
 
+  if (enable_stream_autotune || enable_dot_autotune)
+    load_tune_cache(dev);
+
   if (enable_stream_autotune)
   {
     autotune_stream_kernels(is_intel_gpu, max_wg);
   }
 
-  if (enable_dot_autotune)
+  if (enable_dot_autotune && d_a && d_b)
   {
     autotune_dot(is_intel_gpu, max_wg);
   }
 
+  if (tune_cache_dirty)
+    save_tune_cache();
+
   // Restore benchmark initial conditions after autotune probes.
   init_arrays(initA, initB, initC);
 
@@ -210,14 +220,92 @@ SYCLStream<T>::SYCLStream(BenchId, const intptr_t ARRAY_SIZE, const int device_i
     std::cout << "Dot autotune: enabled" << std::endl;
   else
     std::cout << "Dot autotune: disabled" << std::endl;
+  if (!tune_cache_path.empty())
+    std::cerr << "Autotune cache: " << tune_cache_path
+              << (tune_cache_dirty ? " (updated)" : " (unchanged)") << std::endl;
+}
+
+template <class T>
+void SYCLStream<T>::load_tune_cache(const device &dev)
+{
+  const std::string dir = cache_file::directory("BABELSTREAM_SYCL_AUTOTUNE_CACHE", "BABELSTREAM_SYCL_AUTOTUNE_CACHE_DIR");
+  if (dir.empty())
+    return;
+
+  // Results are only reused on the same device and driver, for the same type and a similar
+  // array size: the bucket is the power of two at or below the size of one array in bytes
+  size_t bytes_log2 = 0;
+  while ((size_t{2} << bytes_log2) <= array_size * sizeof(T))
+    bytes_log2++;
+  const std::pair<std::string, std::string> key[] = {
+    {"device", dev.get_info<info::device::name>()},
+    {"driver", dev.get_info<info::device::driver_version>()},
+    {"type", sizeof(T) == sizeof(double) ? "double" : "float"},
+    {"bytes_log2", std::to_string(bytes_log2)}};
+
+  std::string id;
+  for (const auto &kv : key)
+  {
+    tune_cache[kv.first] = kv.second;
+    id += kv.first + "=" + kv.second + "\n";
+  }
+  tune_cache_path = dir + "/babelstream-sycl-tune-" + cache_file::hash_hex(id) + ".txt";
+
+  // BABELSTREAM_SYCL_RETUNE=1 ignores the stored results and overwrites them
+  if (env_to_bool("BABELSTREAM_SYCL_RETUNE", false))
+    return;
+
+  std::map<std::string, std::string> stored;
+  std::ifstream in(tune_cache_path);
+  for (std::string line; std::getline(in, line);)
+  {
+    const size_t eq = line.find('=');
+    if (eq != std::string::npos)
+      stored[line.substr(0, eq)] = line.substr(eq + 1);
+  }
+  for (const auto &kv : key)
+    if (stored[kv.first] != kv.second)
+      return;
+  tune_cache = stored;
+}
+
+template <class T>
+bool SYCLStream<T>::cached_tune(const std::string &name, size_t &value)
+{
+  auto it = tune_cache.find(name);
+  if (it == tune_cache.end())
+    return false;
+  char *end = nullptr;
+  const unsigned long parsed = std::strtoul(it->second.c_str(), &end, 10);
+  if (end == it->second.c_str() || *end != '\0')
+    return false;
+  value = parsed;
+  return true;
+}
+
+template <class T>
+void SYCLStream<T>::store_tune(const std::string &name, size_t value)
+{
+  if (tune_cache_path.empty())
+    return;
+  tune_cache[name] = std::to_string(value);
+  tune_cache_dirty = true;
+}
+
+template <class T>
+void SYCLStream<T>::save_tune_cache()
+{
+  std::ostringstream out;
+  for (const auto &kv : tune_cache)
+    out << kv.first << "=" << kv.second << "\n";
+  cache_file::write(tune_cache_path, out.str());
 }
 
 template <class T>
 void SYCLStream<T>::autotune_stream_kernels(bool is_intel_gpu, size_t max_wg)
 {
-  queue->memset(d_a, 0, array_size * sizeof(T));
-  queue->memset(d_b, 0, array_size * sizeof(T));
-  queue->memset(d_c, 0, array_size * sizeof(T));
+  for (T *d : {d_a, d_b, d_c})
+    if (d) queue->memset(d, 0, array_size * sizeof(T));
   queue->wait();
 
   std::vector<size_t> wg_candidates;
@@ -231,8 +319,15 @@ void SYCLStream<T>::autotune_stream_kernels(bool is_intel_gpu, size_t max_wg)
 
   const int trials = static_cast<int>(env_to_size_t("BABELSTREAM_SYCL_STREAM_AUTOTUNE_TRIALS", is_intel_gpu ? 3 : 2));
 
-  auto tune_one = [&](size_t &wg, const auto &kernel_call)
+  auto tune_one = [&](const char *name, size_t &wg, const auto &kernel_call)
   {
+    size_t cached_wg;
+    if (cached_tune(name, cached_wg))
+    {
+      wg = std::min(max_wg, std::max<size_t>(cached_wg, 1));
+      return;
+    }
+
     double best_time = std::numeric_limits<double>::max();
     size_t best_wg = wg;
 
@@ -255,18 +350,34 @@ void SYCLStream<T>::autotune_stream_kernels(bool is_intel_gpu, size_t max_wg)
     }
 
     wg = best_wg;
+    store_tune(name, wg);
   };
 
-  tune_one(copy_wgsize, [this]() { this->copy(); });
-  tune_one(mul_wgsize, [this]() { this->mul(); });
-  tune_one(add_wgsize, [this]() { this->add(); });
-  tune_one(triad_wgsize, [this]() { this->triad(); });
-  tune_one(nstream_wgsize, [this]() { this->nstream(); });
+  // Only kernels whose arrays were allocated can run
+  if (d_a && d_c) tune_one("copy_wgsize", copy_wgsize, [this]() { this->copy(); });
+  if (d_b && d_c) tune_one("mul_wgsize", mul_wgsize, [this]() { this->mul(); });
+  if (d_a && d_b && d_c)
+  {
+    tune_one("add_wgsize", add_wgsize, [this]() { this->add(); });
+    tune_one("triad_wgsize", triad_wgsize, [this]() { this->triad(); });
+    tune_one("nstream_wgsize", nstream_wgsize, [this]() { this->nstream(); });
+  }
 }
 
 template <class T>
 void SYCLStream<T>::autotune_dot(bool is_intel_gpu, size_t max_wg)
 {
+  size_t manual, wg, groups, unroll;
+  if (cached_tune("dot_manual_reduction", manual) && cached_tune("dot_wgsize", wg) &&
+      cached_tune("dot_num_groups", groups) && cached_tune("dot_unroll", unroll))
+  {
+    use_manual_dot_reduction = manual != 0;
+    dot_wgsize = std::min(max_wg, std::max<size_t>(wg, 1));
+    dot_num_groups = std::min(dot_sum_capacity, std::max<size_t>(groups, 1));
+    dot_unroll = std::max<size_t>(unroll, 1);
+    return;
+  }
+
   // Initialize arrays to avoid undefined data effects during tuning.
   this->init_arrays(static_cast<T>(1), static_cast<T>(2), static_cast<T>(0));
 
@@ -351,6 +462,11 @@ void SYCLStream<T>::autotune_dot(bool is_intel_gpu, size_t max_wg)
   dot_wgsize = best_wg;
   dot_num_groups = best_groups;
   dot_unroll = best_unroll;
+
+  store_tune("dot_manual_reduction", use_manual_dot_reduction);
+  store_tune("dot_wgsize", dot_wgsize);
+  store_tune("dot_num_groups", dot_num_groups);
+  store_tune("dot_unroll", dot_unroll);
 }
 
 template <class T>
@@ -366,7 +482,7 @@ SYCLStream<T>::~SYCLStream()
 }
 
 template <class T>
-void SYCLStream<T>::copy()
+void SYCLStream<T>::submit_copy()
 {
   const size_t N = array_size;
   T *a = d_a;
@@ -384,11 +500,17 @@ void SYCLStream<T>::copy()
       }
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::copy()
+{
+  submit_copy();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::mul()
+void SYCLStream<T>::submit_mul()
 {
   const T scalar = startScalar;
   const size_t N = array_size;
@@ -407,11 +529,17 @@ void SYCLStream<T>::mul()
       }
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::mul()
+{
+  submit_mul();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::add()
+void SYCLStream<T>::submit_add()
 {
   const size_t N = array_size;
   T *a = d_a;
@@ -430,11 +558,17 @@ void SYCLStream<T>::add()
       }
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::add()
+{
+  submit_add();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::triad()
+void SYCLStream<T>::submit_triad()
 {
   const T scalar = startScalar;
   const size_t N = array_size;
@@ -454,11 +588,17 @@ void SYCLStream<T>::triad()
       }
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::triad()
+{
+  submit_triad();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::nstream()
+void SYCLStream<T>::submit_nstream()
 {
   const T scalar = startScalar;
   const size_t N = array_size;
@@ -478,6 +618,18 @@ void SYCLStream<T>::nstream()
       }
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::nstream()
+{
+  submit_nstream();
+  queue->wait();
+}
+
+template <class T>
+void SYCLStream<T>::sync()
+{
   queue->wait();
 }
 
@@ -590,9 +742,9 @@ void SYCLStream<T>::init_arrays(T initA, T initB, T initC)
       const size_t idx = item.get_global_id(0);
       if (idx < N)
       {
-        a[idx] = initA;
-        b[idx] = initB;
-        c[idx] = initC;
+        if (a) a[idx] = initA;
+        if (b) b[idx] = initB;
+        if (c) c[idx] = initC;
       }
     });
   });
@@ -602,18 +754,18 @@ void SYCLStream<T>::init_arrays(T initA, T initB, T initC)
 template <class T>
 void SYCLStream<T>::get_arrays(T const*& a, T const*& b, T const*& c)
 {
-  h_a.resize(array_size);
-  h_b.resize(array_size);
-  h_c.resize(array_size);
-
-  queue->memcpy(h_a.data(), d_a, array_size * sizeof(T));
-  queue->memcpy(h_b.data(), d_b, array_size * sizeof(T));
-  queue->memcpy(h_c.data(), d_c, array_size * sizeof(T));
+  // Only read back the arrays that were allocated
+  auto read = [&](T *d, std::vector<T> &h) -> T const*
+  {
+    if (!d) return nullptr;
+    h.resize(array_size);
+    queue->memcpy(h.data(), d, array_size * sizeof(T));
+    return h.data();
+  };
+  a = read(d_a, h_a);
+  b = read(d_b, h_b);
+  c = read(d_c, h_c);
   queue->wait();
-
-  a = h_a.data();
-  b = h_b.data();
-  c = h_c.data();
 }
 
 void getDeviceList(void)
@@ -8,7 +8,9 @@
 #pragma once
 
 #include <sstream>
+#include <map>
 #include <memory>
+#include <string>
 
 #include "Stream.h"
 
@@ -77,6 +79,17 @@ class SYCLStream : public Stream<T>
     void autotune_stream_kernels(bool is_intel_gpu, size_t max_wg);
     void autotune_dot(bool is_intel_gpu, size_t max_wg);
 
+    // Autotune results persisted across runs, keyed by device, driver, type and array size
+    std::map<std::string, std::string> tune_cache;
+    std::string tune_cache_path;
+    bool tune_cache_dirty = false;
+
+    void load_tune_cache(const sycl::device &dev);
+    void save_tune_cache();
+    // Looks up a tuned value from an earlier run, or records a newly tuned one
+    bool cached_tune(const std::string &name, size_t &value);
+    void store_tune(const std::string &name, size_t value);
+
   public:
 
     SYCLStream(BenchId bs, const intptr_t array_size, const int device_id,
@@ -90,8 +103,16 @@ class SYCLStream : public Stream<T>
     virtual void nstream() override;
     virtual T    dot() override;
 
+    // Submit without waiting; the queue is in-order
+    virtual void submit_copy() override;
+    virtual void submit_add() override;
+    virtual void submit_mul() override;
+    virtual void submit_triad() override;
+    virtual void submit_nstream() override;
+    virtual void sync() override;
+
     void get_arrays(T const*& a, T const*& b, T const*& c) override;
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
 
 };
 
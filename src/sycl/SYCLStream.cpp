@@ -74,10 +74,10 @@ SYCLStream<T>::SYCLStream(BenchId bs, const intptr_t array_size, const int devic
     }
   }});
   
-  // Create buffers
-  d_a = new buffer<T>(array_size);
-  d_b = new buffer<T>(array_size);
-  d_c = new buffer<T>(array_size);
+  // Create buffers, only for the arrays the selected benchmarks use
+  d_a = needs_buffer(bs, 'a') ? new buffer<T>(array_size) : nullptr;
+  d_b = needs_buffer(bs, 'b') ? new buffer<T>(array_size) : nullptr;
+  d_c = needs_buffer(bs, 'c') ? new buffer<T>(array_size) : nullptr;
   d_sum = new buffer<T>(dot_num_groups);
 
   init_arrays(initA, initB, initC);
@@ -95,7 +95,7 @@ SYCLStream<T>::~SYCLStream()
 }
 
 template <class T>
-void SYCLStream<T>::copy()
+void SYCLStream<T>::submit_copy()
 {
   queue->submit([&](handler &cgh)
   {
@@ -106,11 +106,17 @@ void SYCLStream<T>::copy()
       kc[idx] = ka[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::copy()
+{
+  submit_copy();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::mul()
+void SYCLStream<T>::submit_mul()
 {
   const T scalar = startScalar;
   queue->submit([&](handler &cgh)
@@ -122,11 +128,17 @@ void SYCLStream<T>::mul()
       kb[idx] = scalar * kc[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::mul()
+{
+  submit_mul();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::add()
+void SYCLStream<T>::submit_add()
 {
   queue->submit([&](handler &cgh)
   {
@@ -138,11 +150,17 @@ void SYCLStream<T>::add()
       kc[idx] = ka[idx] + kb[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::add()
+{
+  submit_add();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::triad()
+void SYCLStream<T>::submit_triad()
 {
   const T scalar = startScalar;
   queue->submit([&](handler &cgh)
@@ -155,11 +173,17 @@ void SYCLStream<T>::triad()
       ka[idx] = kb[idx] + scalar * kc[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::triad()
+{
+  submit_triad();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::nstream()
+void SYCLStream<T>::submit_nstream()
 {
   const T scalar = startScalar;
   queue->submit([&](handler &cgh)
@@ -172,6 +196,18 @@ void SYCLStream<T>::nstream()
       ka[idx] += kb[idx] + scalar * kc[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::nstream()
+{
+  submit_nstream();
+  queue->wait();
+}
+
+template <class T>
+void SYCLStream<T>::sync()
+{
   queue->wait();
 }
 
@@ -223,31 +259,37 @@ T SYCLStream<T>::dot()
 template <class T>
 void SYCLStream<T>::init_arrays(T initA, T initB, T initC)
 {
-  queue->submit([&](handler &cgh)
+  // One launch per existing buffer
+  std::pair<buffer<T>*, T> inits[] = {{d_a, initA}, {d_b, initB}, {d_c, initC}};
+  for (auto const& init : inits)
   {
-    auto ka = d_a->template get_access<access::mode::write>(cgh);
-    auto kb = d_b->template get_access<access::mode::write>(cgh);
-    auto kc = d_c->template get_access<access::mode::write>(cgh);
-    cgh.parallel_for<init_kernel>(range<1>{array_size}, [=](item<1> item)
+    if (!init.first) continue;
+    queue->submit([&](handler &cgh)
     {
-      auto id = item.get_id(0);
-      ka[id] = initA;
-      kb[id] = initB;
-      kc[id] = initC;
+      auto k = init.first->template get_access<access::mode::write>(cgh);
+      const T value = init.second;
+      cgh.parallel_for<init_kernel>(range<1>{array_size}, [=](item<1> item)
+      {
+        k[item.get_id(0)] = value;
+      });
     });
-  });
+  }
   queue->wait();
 }
 
 template <class T>
 void SYCLStream<T>::get_arrays(T const*& a, T const*& b, T const*& c)
 {
-  auto _a = d_a->template get_access<access::mode::read>();
-  auto _b = d_b->template get_access<access::mode::read>();
-  auto _c = d_c->template get_access<access::mode::read>();
-  a = &_a[0];
-  b = &_b[0];
-  c = &_c[0];
+  // Arrays the selected benchmarks do not use have no buffer
+  auto read = [](buffer<T> *d) -> T const*
+  {
+    if (!d) return nullptr;
+    auto h = d->template get_access<access::mode::read>();
+    return &h[0];
+  };
+  a = read(d_a);
+  b = read(d_b);
+  c = read(d_c);
 }
 
 void getDeviceList(void)
@@ -65,8 +65,16 @@ class SYCLStream : public Stream<T>
     void nstream() override;
     T    dot() override;
 
+    // Submit without waiting; accessors order the kernels
+    void submit_copy() override;
+    void submit_add() override;
+    void submit_mul() override;
+    void submit_triad() override;
+    void submit_nstream() override;
+    void sync() override;
+
     void get_arrays(T const*& a, T const*& b, T const*& c) override;
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
 };
 
 // Populate the devices list
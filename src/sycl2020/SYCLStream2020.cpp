@@ -8,6 +8,7 @@
 #include "SYCLStream2020.h"
 
 #include <iostream>
+#include <tuple>
 
 #define ALIGNMENT (1024 * 1024 * 2)
 
@@ -42,6 +43,7 @@ SYCLStream<T>::SYCLStream(BenchId bs, const intptr_t array_size, const int devic
     }
   }
 
+  // In-order, so kernels submitted back-to-back without waiting (--batch) run in program order
   queue = std::make_unique<sycl::queue>(dev, sycl::async_handler{[&](sycl::exception_list l)
   {
     bool error = false;
@@ -61,25 +63,28 @@ SYCLStream<T>::SYCLStream(BenchId bs, const intptr_t array_size, const int devic
     {
       throw std::runtime_error("SYCL errors detected");
     }
-  }});
+  }}, sycl::property_list{sycl::property::queue::in_order{}});
 
-  // Allocate memory
+  // Allocate memory, only for the arrays the selected benchmarks use
+  use_a = needs_buffer(bs, 'a');
+  use_b = needs_buffer(bs, 'b');
+  use_c = needs_buffer(bs, 'c');
 #if defined(PAGEFAULT)
-  a = (T*)aligned_alloc(ALIGNMENT, array_size * sizeof(T));
-  b = (T*)aligned_alloc(ALIGNMENT, array_size * sizeof(T));
-  c = (T*)aligned_alloc(ALIGNMENT, array_size * sizeof(T));
+  a = use_a ? (T*)aligned_alloc(ALIGNMENT, array_size * sizeof(T)) : nullptr;
+  b = use_b ? (T*)aligned_alloc(ALIGNMENT, array_size * sizeof(T)) : nullptr;
+  c = use_c ? (T*)aligned_alloc(ALIGNMENT, array_size * sizeof(T)) : nullptr;
   sum = (T*)aligned_alloc(ALIGNMENT, ALIGNMENT);
 
-#elseif defined(SYCL2020ACC)
-  d_a = sycl::buffer<T>{array_size};
-  d_b = sycl::buffer<T>{array_size};
-  d_c = sycl::buffer<T>{array_size};
+#elif defined(SYCL2020ACC)
+  d_a = sycl::buffer<T>{size_t(use_a ? array_size : 1)};
+  d_b = sycl::buffer<T>{size_t(use_b ? array_size : 1)};
+  d_c = sycl::buffer<T>{size_t(use_c ? array_size : 1)};
   d_sum = sycl::buffer<T>{1};
 
 #elif SYCL2020USM
-  a = sycl::malloc_shared<T>(array_size, *queue);
-  b = sycl::malloc_shared<T>(array_size, *queue);
-  c = sycl::malloc_shared<T>(array_size, *queue);
+  a = use_a ? sycl::malloc_shared<T>(array_size, *queue) : nullptr;
+  b = use_b ? sycl::malloc_shared<T>(array_size, *queue) : nullptr;
+  c = use_c ? sycl::malloc_shared<T>(array_size, *queue) : nullptr;
   sum = sycl::malloc_shared<T>(1, *queue);
 
 #else
@@ -100,18 +105,16 @@ SYCLStream<T>::~SYCLStream() {
  free(b);
  free(c);
  free(sum);
-#ifdef SYCL2020USM
+#elif defined(SYCL2020USM)
   sycl::free(a, *queue);
   sycl::free(b, *queue);
   sycl::free(c, *queue);
   sycl::free(sum, *queue);
-#else
-  #error unimplemented
 #endif
 }
 
 template <class T>
-void SYCLStream<T>::copy()
+void SYCLStream<T>::submit_copy()
 {
   queue->submit([&](sycl::handler &cgh)
   {
@@ -124,11 +127,17 @@ void SYCLStream<T>::copy()
       c[idx] = a[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::copy()
+{
+  submit_copy();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::mul()
+void SYCLStream<T>::submit_mul()
 {
   const T scalar = startScalar;
   queue->submit([&](sycl::handler &cgh)
@@ -142,11 +151,17 @@ void SYCLStream<T>::mul()
       b[idx] = scalar * c[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::mul()
+{
+  submit_mul();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::add()
+void SYCLStream<T>::submit_add()
 {
   queue->submit([&](sycl::handler &cgh)
   {
@@ -160,11 +175,17 @@ void SYCLStream<T>::add()
       c[idx] = a[idx] + b[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::add()
+{
+  submit_add();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::triad()
+void SYCLStream<T>::submit_triad()
 {
   const T scalar = startScalar;
   queue->submit([&](sycl::handler &cgh)
@@ -179,11 +200,17 @@ void SYCLStream<T>::triad()
       a[idx] = b[idx] + scalar * c[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::triad()
+{
+  submit_triad();
   queue->wait();
 }
 
 template <class T>
-void SYCLStream<T>::nstream()
+void SYCLStream<T>::submit_nstream()
 {
   const T scalar = startScalar;
   queue->submit([&](sycl::handler &cgh)
@@ -198,6 +225,18 @@ void SYCLStream<T>::nstream()
       a[idx] += b[idx] + scalar * c[idx];
     });
   });
+}
+
+template <class T>
+void SYCLStream<T>::nstream()
+{
+  submit_nstream();
+  queue->wait();
+}
+
+template <class T>
+void SYCLStream<T>::sync()
+{
   queue->wait();
 }
 
@@ -233,25 +272,29 @@ void SYCLStream<T>::init_arrays(T initA, T initB, T initC)
 #if defined(PAGEFAULT)
   for (int i = 0; i < array_size; i++)
   {
-    a[i] = initA;
-    b[i] = initB;
-    c[i] = initC;
+    if (use_a) a[i] = initA;
+    if (use_b) b[i] = initB;
+    if (use_c) c[i] = initC;
   }
-#else
-  queue->submit([&](sycl::handler &cgh)
+#elif SYCL2020ACC
+  // One fill per array the selected benchmarks use
+  std::tuple<bool, sycl::buffer<T>*, T> inits[] = {{use_a, &d_a, initA}, {use_b, &d_b, initB}, {use_c, &d_c, initC}};
+  for (auto const& init : inits)
   {
-#if SYCL2020ACC    
-    sycl::accessor a {d_a, cgh, sycl::write_only, sycl::no_init};
-    sycl::accessor b {d_b, cgh, sycl::write_only, sycl::no_init};
-    sycl::accessor c {d_c, cgh, sycl::write_only, sycl::no_init};
-#endif
-    cgh.parallel_for(sycl::range<1>{array_size}, [=,a=a,b=b,c=c](sycl::id<1> idx)
+    if (!std::get<0>(init)) continue;
+    sycl::buffer<T>* d = std::get<1>(init);
+    T value = std::get<2>(init);
+    queue->submit([&](sycl::handler &cgh)
     {
-      a[idx] = initA;
-      b[idx] = initB;
-      c[idx] = initC;
+      sycl::accessor k {*d, cgh, sycl::write_only, sycl::no_init};
+      cgh.fill(k, value);
     });
-  });
+  }
+  queue->wait();
+#else
+  if (use_a) queue->fill(a, initA, array_size);
+  if (use_b) queue->fill(b, initB, array_size);
+  if (use_c) queue->fill(c, initC, array_size);
   queue->wait();
 #endif
 }
@@ -264,9 +307,9 @@ void SYCLStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
   sycl::host_accessor b {d_b, sycl::read_only};
   sycl::host_accessor c {d_c, sycl::read_only};
 #endif  
-  h_a = &a[0];
-  h_b = &b[0];
-  h_c = &c[0];
+  h_a = use_a ? &a[0] : nullptr;
+  h_b = use_b ? &b[0] : nullptr;
+  h_c = use_c ? &c[0] : nullptr;
 }
 
 void getDeviceList(void)
@@ -39,6 +39,9 @@ class SYCLStream : public Stream<T>
     T *a, *b, *c, *sum{};
     sycl::buffer<T> d_a, d_b, d_c, d_sum;
 
+    // Arrays the selected benchmarks use; the others are not allocated (1-element buffers with SYCL2020ACC)
+    bool use_a, use_b, use_c;
+
   public:
 
     SYCLStream(BenchId bs, const intptr_t array_size, const int device_id,
@@ -52,8 +55,16 @@ class SYCLStream : public Stream<T>
     void nstream() override;
     T    dot() override;
 
+    // Submit without waiting; the queue is in-order
+    void submit_copy() override;
+    void submit_add() override;
+    void submit_mul() override;
+    void submit_triad() override;
+    void submit_nstream() override;
+    void sync() override;
+
     void get_arrays(T const*& a, T const*& b, T const*& c) override;    
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
 };
 
 // Populate the devices list
@@ -5,7 +5,11 @@
 // source code
 
 #include "TBBStream.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <cstdlib>
+#include <string>
 
 #ifndef ALIGNMENT
 #define ALIGNMENT (2*1024*1024) // 2MB
@@ -19,50 +23,156 @@
 #define END(x) ((x) + array_size)
 #endif
 
+namespace
+{
+  // Accepts "auto", "affinity", "static" or "simple", optionally with a "_partitioner" suffix
+  template <typename P>
+  bool parse_partitioner(std::string name, P& kind)
+  {
+    auto suffix = name.find("_partitioner");
+    if (suffix != std::string::npos) name = name.substr(0, suffix);
+    if (name == "auto") kind = P::Auto;
+    else if (name == "affinity") kind = P::Affinity;
+    else if (name == "static") kind = P::Static;
+    else if (name == "simple") kind = P::Simple;
+    else return false;
+    return true;
+  }
+
+  // A positive integer with nothing after it
+  bool parse_grainsize(char const* str, size_t& grainsize)
+  {
+    char* end;
+    errno = 0;
+    unsigned long long value = std::strtoull(str, &end, 10);
+    if (errno || *end || !std::isdigit((unsigned char)*str) || value == 0) return false;
+    grainsize = (size_t)value;
+    return true;
+  }
+
+  char const* env_string(char const* name)
+  {
+    char const* env = std::getenv(name);
+    return env && *env ? env : nullptr;
+  }
+}
+
 template <class T>
 TBBStream<T>::TBBStream(BenchId bs, const intptr_t array_size, const int device,
 			T initA, T initB, T initC)
-  : partitioner(), range(0, (size_t)array_size),
-#ifdef USE_VECTOR
-   a(array_size), b(array_size), c(array_size)
-#else
-   array_size(array_size),
-   a((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size)),
-   b((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size)),
-   c((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size))
+#ifndef USE_VECTOR
+  : array_size(array_size), a(nullptr), b(nullptr), c(nullptr)
 #endif
 {
   if(device != 0){
     throw std::runtime_error("Device != 0 is not supported by TBB");
   }
-  std::cout << "Using TBB partitioner: " PARTITIONER_NAME << std::endl;
-  std::cout << "Backing storage typeid: " << typeid(a).name() << std::endl;
+
+  // The environment is checked before anything is allocated
+  parse_partitioner(PARTITIONER_NAME, partitioner);
+  if (char const* env = env_string("BABELSTREAM_TBB_PARTITIONER"))
+    if (!parse_partitioner(env, partitioner))
+      throw std::runtime_error(std::string("Invalid BABELSTREAM_TBB_PARTITIONER: ") + env);
+  if (char const* env = env_string("BABELSTREAM_TBB_GRAINSIZE"))
+    if (!parse_grainsize(env, grainsize))
+      throw std::runtime_error(std::string("Invalid BABELSTREAM_TBB_GRAINSIZE: ") + env);
+
+  std::vector<int> nodes;
+  char const* numa = env_string("BABELSTREAM_TBB_NUMA");
+  if (numa && std::string(numa) != "0") {
+#if TBB_VERSION_MAJOR >= 2021
+    for (auto node : tbb::info::numa_nodes()) nodes.push_back(node);
+#else
+    throw std::runtime_error("BABELSTREAM_TBB_NUMA requires oneTBB 2021 or newer");
+#endif
+  }
+
+  // Split the arrays evenly between nodes; without NUMA arenas the whole range is one slice
+  size_t n = (size_t)array_size;
+  size_t count = std::max<size_t>(nodes.size(), 1);
+  for (size_t i = 0; i < count; ++i) {
+    auto s = std::make_unique<Slice>();
+    s->begin = n * i / count;
+    s->end = n * (i + 1) / count;
+    s->thread_offset = max_threads;
+#if TBB_VERSION_MAJOR >= 2021
+    if (!nodes.empty()) {
+      s->arena = std::make_unique<tbb::task_arena>(tbb::task_arena::constraints(nodes[i]));
+      s->arena->initialize();
+    }
+#endif
+    max_threads += s->arena ? s->arena->max_concurrency() : tbb::this_task_arena::max_concurrency();
+    slices.push_back(std::move(s));
+  }
+
+  // Only the arrays the selected benchmarks use are allocated
+#ifdef USE_VECTOR
+  a.resize(needs_buffer(bs, 'a') ? array_size : 0);
+  b.resize(needs_buffer(bs, 'b') ? array_size : 0);
+  c.resize(needs_buffer(bs, 'c') ? array_size : 0);
+#else
+  if (needs_buffer(bs, 'a')) a = (T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size);
+  if (needs_buffer(bs, 'b')) b = (T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size);
+  if (needs_buffer(bs, 'c')) c = (T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size);
+#endif
+
+  char const* names[] = {"auto", "affinity", "static", "simple"};
+  std::cerr << "Using TBB partitioner: " << names[(int)partitioner] << "_partitioner"
+            << ", grain size: " << grainsize << std::endl;
+  if (!nodes.empty()) {
+    std::cerr << "NUMA arenas:";
+    for (size_t i = 0; i < slices.size(); ++i)
+      std::cerr << " node " << nodes[i] << " (" << slices[i]->arena->max_concurrency()
+                << " threads, elements " << slices[i]->begin << "-" << slices[i]->end << ")";
+    std::cerr << std::endl;
+  }
+  std::cerr << "Backing storage typeid: " << typeid(a).name() << std::endl;
 
   init_arrays(initA, initB, initC);
 }
 
+template <class T>
+TBBStream<T>::~TBBStream()
+{
+  profile.report(std::cerr, IMPLEMENTATION_STRING);
+#ifndef USE_VECTOR
+  free(a);
+  free(b);
+  free(c);
+#endif
+}
 
 template <class T>
 void TBBStream<T>::init_arrays(T initA, T initB, T initC)
 {
-
-  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
-    for (size_t i = r.begin(); i < r.end(); ++i) {
-      a[i] = initA;
-      b[i] = initB;
-      c[i] = initC;
-    }
-  }, partitioner);
-
+  // Initialised through the slices so pages are first touched on their slice's NUMA node
+  // Arrays the selection does not use are empty
+#ifdef USE_VECTOR
+  T *pa = a.empty() ? nullptr : a.data(), *pb = b.empty() ? nullptr : b.data(), *pc = c.empty() ? nullptr : c.data();
+#else
+  T *pa = a, *pb = b, *pc = c;
+#endif
+  on_slices([&](Slice& s) {
+    with_partitioner(s, [&](auto& p) {
+      tbb::parallel_for(tbb::blocked_range<size_t>(s.begin, s.end, grainsize),
+                        [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+          if (pa) pa[i] = initA;
+          if (pb) pb[i] = initB;
+          if (pc) pc[i] = initC;
+        }
+      }, p);
+    });
+  });
 }
 
 template <class T>
 void TBBStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
 {
 #ifdef USE_VECTOR
-  h_a = a.data();
-  h_b = b.data();
-  h_c = c.data();
+  h_a = a.empty() ? nullptr : a.data();
+  h_b = b.empty() ? nullptr : b.data();
+  h_c = c.empty() ? nullptr : c.data();
 #else
   h_a = a;
   h_b = b;
@@ -70,14 +180,110 @@ void TBBStream<T>::get_arrays(T const*& h_a, T const*& h_b, T const*& h_c)
 #endif
 }
 
+template <class T>
+template <typename F>
+void TBBStream<T>::on_slices(F f)
+{
+  if (!slices.front()->arena) return f(*slices.front());
+  // Spawn every slice into its own arena before waiting on any of them
+  for (auto& s : slices)
+    s->arena->execute([&] { s->group.run([&] { f(*s); }); });
+  for (auto& s : slices)
+    s->arena->execute([&] { s->group.wait(); });
+}
+
+template <class T>
+template <typename F>
+void TBBStream<T>::with_partitioner(Slice& s, F f)
+{
+  switch (partitioner) {
+  case Partitioner::Affinity: return f(s.affinity);
+  case Partitioner::Static:   { tbb::static_partitioner p; return f(p); }
+  case Partitioner::Simple:   { tbb::simple_partitioner p; return f(p); }
+  default:                    { tbb::auto_partitioner p; return f(p); }
+  }
+}
+
+template <class T>
+template <typename F>
+void TBBStream<T>::for_each_chunk(char const* kernel, F body)
+{
+  if (profile.enabled()) profile.begin(max_threads);
+  on_slices([&](Slice& s) {
+    tbb::blocked_range<size_t> range(s.begin, s.end, grainsize);
+    with_partitioner(s, [&](auto& p) {
+      if (!profile.enabled())
+        return tbb::parallel_for(range, body, p);
+      tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+        double t0 = ThreadProfile::now();
+        body(r);
+        profile.record(s.thread_offset + tbb::this_task_arena::current_thread_index(), t0,
+                       ThreadProfile::now(), r.size());
+      }, p);
+    });
+  });
+  if (profile.enabled()) profile.end(kernel);
+}
+
+template <class T>
+template <typename F>
+T TBBStream<T>::reduce_chunks(char const* kernel, F body)
+{
+  if (profile.enabled()) profile.begin(max_threads);
+  on_slices([&](Slice& s) {
+    tbb::blocked_range<size_t> range(s.begin, s.end, grainsize);
+    with_partitioner(s, [&](auto& p) {
+      if (!profile.enabled()) {
+        s.sum = tbb::parallel_reduce(range, T{}, body, std::plus<T>(), p);
+        return;
+      }
+      s.sum = tbb::parallel_reduce(range, T{}, [&](const tbb::blocked_range<size_t>& r, T acc) {
+        double t0 = ThreadProfile::now();
+        acc = body(r, acc);
+        profile.record(s.thread_offset + tbb::this_task_arena::current_thread_index(), t0,
+                       ThreadProfile::now(), r.size());
+        return acc;
+      }, std::plus<T>(), p);
+    });
+  });
+  if (profile.enabled()) profile.end(kernel);
+  T sum{};
+  for (auto& s : slices) sum += s->sum;
+  return sum;
+}
+
+template <class T>
+std::vector<TuneParam> TBBStream<T>::tune_space()
+{
+  // Grain sizes from TBB's default to one chunk per thread
+  size_t n = 0;
+  for (auto& s : slices) n += s->end - s->begin;
+  TuneParam grain{"grainsize", {1}};
+  for (size_t chunks : {64, 8, 1})
+    grain.values.push_back((long)std::max<size_t>(n / (max_threads * chunks), 1));
+  return {{"partitioner", {(long)Partitioner::Auto, (long)Partitioner::Affinity,
+                           (long)Partitioner::Static, (long)Partitioner::Simple},
+           {"auto", "affinity", "static", "simple"}},
+          grain};
+}
+
+template <class T>
+void TBBStream<T>::set_tune_param(std::string const& name, long value)
+{
+  if (name == "partitioner" && value >= 0 && value <= (long)Partitioner::Simple)
+    partitioner = (Partitioner)value;
+  else if (name == "grainsize")
+    grainsize = (size_t)std::max<long>(value, 1);
+}
+
 template <class T>
 void TBBStream<T>::copy()
 {
-  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+  for_each_chunk("Copy", [&](const tbb::blocked_range<size_t>& r) {
     for (size_t i = r.begin(); i < r.end(); ++i) {
        c[i] = a[i];
     }
-  }, partitioner);
+  });
 }
 
 template <class T>
@@ -85,11 +291,11 @@ void TBBStream<T>::mul()
 {
   const T scalar = startScalar;
 
-  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+  for_each_chunk("Mul", [&](const tbb::blocked_range<size_t>& r) {
     for (size_t i = r.begin(); i < r.end(); ++i) {
        b[i] = scalar * c[i];
     }
-  }, partitioner);
+  });
 
 }
 
@@ -97,11 +303,11 @@ template <class T>
 void TBBStream<T>::add()
 {
 
-  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+  for_each_chunk("Add", [&](const tbb::blocked_range<size_t>& r) {
     for (size_t i = r.begin(); i < r.end(); ++i) {
        c[i] = a[i] + b[i];
     }
-  }, partitioner);
+  });
 
 }
 
@@ -110,11 +316,11 @@ void TBBStream<T>::triad()
 {
   const T scalar = startScalar;
 
-  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+  for_each_chunk("Triad", [&](const tbb::blocked_range<size_t>& r) {
     for (size_t i = r.begin(); i < r.end(); ++i) {
        a[i] = b[i] + scalar * c[i];
     }
-  }, partitioner);
+  });
 
 }
 
@@ -123,11 +329,11 @@ void TBBStream<T>::nstream()
 {
   const T scalar = startScalar;
 
-  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+  for_each_chunk("Nstream", [&](const tbb::blocked_range<size_t>& r) {
     for (size_t i = r.begin(); i < r.end(); ++i) {
        a[i] += b[i] + scalar * c[i];
     }
-  }, partitioner);
+  });
 
 }
 
@@ -136,14 +342,153 @@ T TBBStream<T>::dot()
 {
   // sum += a[i] * b[i];
   return
-    tbb::parallel_reduce(range, T{}, [&](const tbb::blocked_range<size_t>& r, T acc) {
+    reduce_chunks("Dot", [&](const tbb::blocked_range<size_t>& r, T acc) {
       for (size_t i = r.begin(); i < r.end(); ++i) {
         acc += a[i] * b[i];
       }
       return acc;
-    }, std::plus<T>(), partitioner);
+    });
 }
 
+template <class T>
+TBBComplexStream<T>::TBBComplexStream(const intptr_t array_size, const int device,
+                                      std::complex<T> initA, std::complex<T> initB, std::complex<T> initC)
+  : partitioner(), range(0, (size_t)array_size), array_size(array_size),
+   a((std::complex<T> *) aligned_alloc(ALIGNMENT, sizeof(std::complex<T>) * array_size)),
+   b((std::complex<T> *) aligned_alloc(ALIGNMENT, sizeof(std::complex<T>) * array_size)),
+   c((std::complex<T> *) aligned_alloc(ALIGNMENT, sizeof(std::complex<T>) * array_size)),
+   a_re((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size)),
+   a_im((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size)),
+   b_re((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size)),
+   b_im((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size)),
+   c_re((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size)),
+   c_im((T *) aligned_alloc(ALIGNMENT, sizeof(T) * array_size))
+{
+  if(device != 0){
+    throw std::runtime_error("Device != 0 is not supported by TBB");
+  }
+
+  init_arrays(initA, initB, initC);
+}
+
+template <class T>
+TBBComplexStream<T>::~TBBComplexStream()
+{
+  free(a);
+  free(b);
+  free(c);
+  free(a_re);
+  free(a_im);
+  free(b_re);
+  free(b_im);
+  free(c_re);
+  free(c_im);
+}
+
+template <class T>
+void TBBComplexStream<T>::init_arrays(std::complex<T> initA, std::complex<T> initB, std::complex<T> initC)
+{
+  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+    for (size_t i = r.begin(); i < r.end(); ++i) {
+      a[i] = initA;
+      b[i] = initB;
+      c[i] = initC;
+      a_re[i] = initA.real();
+      a_im[i] = initA.imag();
+      b_re[i] = initB.real();
+      b_im[i] = initB.imag();
+      c_re[i] = initC.real();
+      c_im[i] = initC.imag();
+    }
+  }, partitioner);
+}
+
+template <class T>
+void TBBComplexStream<T>::get_arrays_aos(std::complex<T> const*& h_a, std::complex<T> const*& h_b,
+                                         std::complex<T> const*& h_c)
+{
+  h_a = a;
+  h_b = b;
+  h_c = c;
+}
+
+template <class T>
+void TBBComplexStream<T>::get_arrays_soa(T const*& h_a_re, T const*& h_a_im, T const*& h_b_re, T const*& h_b_im,
+                                         T const*& h_c_re, T const*& h_c_im)
+{
+  h_a_re = a_re;
+  h_a_im = a_im;
+  h_b_re = b_re;
+  h_b_im = b_im;
+  h_c_re = c_re;
+  h_c_im = c_im;
+}
+
+template <class T>
+void TBBComplexStream<T>::triad_aos()
+{
+  const T s_re = complexScalar<T>().real();
+  const T s_im = complexScalar<T>().imag();
+
+  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+    for (size_t i = r.begin(); i < r.end(); ++i) {
+      const T cr = c[i].real();
+      const T ci = c[i].imag();
+      a[i] = std::complex<T>(b[i].real() + s_re * cr - s_im * ci,
+                             b[i].imag() + s_re * ci + s_im * cr);
+    }
+  }, partitioner);
+}
+
+template <class T>
+void TBBComplexStream<T>::triad_soa()
+{
+  const T s_re = complexScalar<T>().real();
+  const T s_im = complexScalar<T>().imag();
+
+  tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& r) {
+    for (size_t i = r.begin(); i < r.end(); ++i) {
+      a_re[i] = b_re[i] + s_re * c_re[i] - s_im * c_im[i];
+      a_im[i] = b_im[i] + s_re * c_im[i] + s_im * c_re[i];
+    }
+  }, partitioner);
+}
+
+template <class T>
+std::complex<T> TBBComplexStream<T>::dot_aos()
+{
+  // sum += a[i] * b[i];
+  return
+    tbb::parallel_reduce(range, std::complex<T>{}, [&](const tbb::blocked_range<size_t>& r, std::complex<T> acc) {
+      T acc_re = acc.real();
+      T acc_im = acc.imag();
+      for (size_t i = r.begin(); i < r.end(); ++i) {
+        acc_re += a[i].real() * b[i].real() - a[i].imag() * b[i].imag();
+        acc_im += a[i].real() * b[i].imag() + a[i].imag() * b[i].real();
+      }
+      return std::complex<T>(acc_re, acc_im);
+    }, std::plus<std::complex<T>>(), partitioner);
+}
+
+template <class T>
+std::complex<T> TBBComplexStream<T>::dot_soa()
+{
+  // sum += a[i] * b[i];
+  return
+    tbb::parallel_reduce(range, std::complex<T>{}, [&](const tbb::blocked_range<size_t>& r, std::complex<T> acc) {
+      T acc_re = acc.real();
+      T acc_im = acc.imag();
+      for (size_t i = r.begin(); i < r.end(); ++i) {
+        acc_re += a_re[i] * b_re[i] - a_im[i] * b_im[i];
+        acc_im += a_re[i] * b_im[i] + a_im[i] * b_re[i];
+      }
+      return std::complex<T>(acc_re, acc_im);
+    }, std::plus<std::complex<T>>(), partitioner);
+}
+
+template class TBBComplexStream<float>;
+template class TBBComplexStream<double>;
+
 void listDevices(void)
 {
    std::cout << "Listing devices is not supported by TBB" << std::endl;
@@ -7,9 +7,11 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include "tbb/tbb.h"
 #include "Stream.h"
+#include "ThreadProfile.h"
 
 #define IMPLEMENTATION_STRING "TBB"
 
@@ -35,9 +37,28 @@ template <class T>
 class TBBStream : public Stream<T>
 {
   protected:
-  
-    tbb_partitioner partitioner;
-    tbb::blocked_range<size_t> range;
+
+    // Partitioner and grain size, from BABELSTREAM_TBB_PARTITIONER/BABELSTREAM_TBB_GRAINSIZE; the
+    // partitioner defaults to the one selected at build time
+    enum class Partitioner {Auto, Affinity, Static, Simple};
+    Partitioner partitioner;
+    size_t grainsize = 1;
+
+    // A contiguous part of the arrays. There is a single slice run in the calling thread's arena,
+    // or with BABELSTREAM_TBB_NUMA=1 one per NUMA node, each run in an arena constrained to it.
+    struct Slice {
+      size_t begin, end;
+      std::unique_ptr<tbb::task_arena> arena;
+      tbb::task_group group;
+      // Kept across kernels so affinity_partitioner replays the previous chunk placement
+      tbb::affinity_partitioner affinity;
+      // First profile slot of this slice's threads
+      size_t thread_offset = 0;
+      T sum{};
+    };
+    std::vector<std::unique_ptr<Slice>> slices;
+    size_t max_threads = 0;
+
     // Device side pointers
 #ifdef USE_VECTOR
     std::vector<T> a, b, c;
@@ -46,10 +67,26 @@ class TBBStream : public Stream<T>
     T *a, *b, *c;
 #endif
 
+    // Per-thread timings, when enabled with BABELSTREAM_THREAD_PROFILE=1
+    ThreadProfile profile;
+
+    // Runs f(slice) for every slice, concurrently across NUMA arenas
+    template <typename F>
+    void on_slices(F f);
+    // Calls f with the selected partitioner (the slice's own affinity_partitioner for Affinity)
+    template <typename F>
+    void with_partitioner(Slice& s, F f);
+
+    // parallel_for/parallel_reduce over the arrays, recording each chunk's timing when profiling
+    template <typename F>
+    void for_each_chunk(char const* kernel, F body);
+    template <typename F>
+    T reduce_chunks(char const* kernel, F body);
+
   public:
     TBBStream(BenchId bs, const intptr_t array_size, const int device_id,
 	      T initA, T initB, T initC);
-    ~TBBStream() = default;
+    ~TBBStream();
 
     void copy() override;
     void add() override;
@@ -59,5 +96,43 @@ class TBBStream : public Stream<T>
     T dot() override;
 
     void get_arrays(T const*& a, T const*& b, T const*& c) override;  
-    void init_arrays(T initA, T initB, T initC);
+    void init_arrays(T initA, T initB, T initC) override;
+
+    // Partitioner (in Partitioner order) and grain size
+    std::vector<TuneParam> tune_space() override;
+    void set_tune_param(std::string const& name, long value) override;
+};
+
+#include "ComplexStream.h"
+
+template <class T>
+class TBBComplexStream : public ComplexStream<T>
+{
+  protected:
+
+    tbb_partitioner partitioner;
+    tbb::blocked_range<size_t> range;
+    size_t array_size;
+
+    // AoS: interleaved real/imaginary parts
+    std::complex<T> *a, *b, *c;
+
+    // SoA: separate real and imaginary arrays
+    T *a_re, *a_im, *b_re, *b_im, *c_re, *c_im;
+
+  public:
+    TBBComplexStream(const intptr_t array_size, const int device_id,
+                     std::complex<T> initA, std::complex<T> initB, std::complex<T> initC);
+    ~TBBComplexStream();
+
+    void triad_aos() override;
+    void triad_soa() override;
+    std::complex<T> dot_aos() override;
+    std::complex<T> dot_soa() override;
+
+    void get_arrays_aos(std::complex<T> const*& a, std::complex<T> const*& b,
+                        std::complex<T> const*& c) override;
+    void get_arrays_soa(T const*& a_re, T const*& a_im, T const*& b_re, T const*& b_im,
+                        T const*& c_re, T const*& c_im) override;
+    void init_arrays(std::complex<T> initA, std::complex<T> initB, std::complex<T> initC);
 };
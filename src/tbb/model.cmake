@@ -12,7 +12,8 @@ register_flag_optional(PARTITIONER
             AFFINITY - Proportional splitting that optimizes for cache affinity.
             STATIC   - Distribute work uniformly with no additional load balancing.
             SIMPLE   - Recursively split its range until it cannot be further subdivided.
-            See https://spec.oneapi.com/versions/latest/elements/oneTBB/source/algorithms.html#partitioners for more details."
+            See https://spec.oneapi.com/versions/latest/elements/oneTBB/source/algorithms.html#partitioners for more details.
+         This is the default. BABELSTREAM_TBB_PARTITIONER selects another at runtime."
         "AUTO")
 
 register_flag_optional(USE_VECTOR
@@ -21,7 +21,11 @@ static inline void synchronise()
 template <class T>
 ThrustStream<T>::ThrustStream(BenchId bs, const intptr_t array_size, const int device,
 			      T initA, T initB, T initC)
-    : array_size{array_size}, a(array_size), b(array_size), c(array_size) {
+    // Arrays the selected benchmarks do not use are left empty
+    : array_size{array_size},
+      a(needs_buffer(bs, 'a') ? array_size : 0),
+      b(needs_buffer(bs, 'b') ? array_size : 0),
+      c(needs_buffer(bs, 'c') ? array_size : 0) {
   std::cout << "Using CUDA device: " << getDeviceName(device) << std::endl;
   std::cout << "Driver: " << getDeviceDriver(device) << std::endl;
   std::cout << "Thrust version: " << THRUST_VERSION << std::endl;
@@ -63,19 +67,20 @@ template <class T>
 void ThrustStream<T>::get_arrays(T const*& a_, T const*& b_, T const*& c_)
 {
   #if defined(MANAGED)
-  a_ = &*a.data();
-  b_ = &*b.data();
-  c_ = &*c.data();
+  a_ = a.empty() ? nullptr : &*a.data();
+  b_ = b.empty() ? nullptr : &*b.data();
+  c_ = c.empty() ? nullptr : &*c.data();
   #else
-  h_a.resize(array_size);
-  h_b.resize(array_size);
-  h_c.resize(array_size);
-  thrust::copy(a.begin(), a.end(), h_a.begin());
-  thrust::copy(b.begin(), b.end(), h_b.begin());
-  thrust::copy(c.begin(), c.end(), h_c.begin());
-  a_ = h_a.data();
-  b_ = h_b.data();
-  c_ = h_c.data();
+  // Only the arrays the selected benchmarks use are copied back
+  auto read = [&](thrust::device_vector<T> const& d, std::vector<T>& h) -> T const* {
+    if (d.empty()) return nullptr;
+    h.resize(array_size);
+    thrust::copy(d.begin(), d.end(), h.begin());
+    return h.data();
+  };
+  a_ = read(a, h_a);
+  b_ = read(b, h_b);
+  c_ = read(c, h_c);
   #endif
 }
 